@@ -0,0 +1,210 @@
+// Times the sumset primitives of sumset.h and io.h on their own, in ns per call.
+// Usage: bench_sumset [--d LIST] [--samples N] [--warmup N] [--cpu N]
+// For each d (comma-separated LIST, default 10,20,30,40,50) and distribution of the added elements, it builds
+// pairs of sumsets the way the search does: random walks from A_0 = ∅, B_0 = {1}, adding x to the smaller multiset
+// while the intersection stays {0}. The added x are uniform among the candidates, or the smallest (low) or the biggest
+// (high) of two uniform draws. A sample is one call per pair, the first samples are a warmup.
+// Prints CSV: the primitive, d, distribution, kernels (see sumset_kernels.c), calls per sample and the min, median,
+// 90th and 99th percentile of the samples in ns per call. The process is pinned to one CPU (--cpu, default 0).
+// Built with SUMSET_BOUNDED, like nonrecursive and parallel.
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "common/err.h"
+#include "common/io.h"
+#include "common/sumset.h"
+
+// Number of pairs, one sample calls the primitive once for each
+#define PAIRS 1024
+#define MAX_VALUES 16
+#define MAX_SAMPLES 100000
+
+// A node of a walk, with a and b ordered by sum as in the search, and arguments for the primitives
+typedef struct {
+    const Sumset *small, *big;
+    int x; // An element that can be added to small (a candidate child)
+    int value; // A value up to small->sum + d, for does_sumset_contain()
+} Pair;
+
+enum { UNIFORM, LOW, HIGH, DISTRIBUTIONS };
+static const char* distribution_names[DISTRIBUTIONS] = { "uniform", "low", "high" };
+
+static unsigned seed = 1;
+
+// Returns a candidate among the bits of mask (not 0), drawn with the distribution
+static int draw(Word mask, int distribution)
+{
+    int count = __builtin_popcountll(mask);
+    int k = rand_r(&seed) % count;
+    if (distribution != UNIFORM) {
+        int other = rand_r(&seed) % count;
+        k = (distribution == LOW) ? (k < other ? k : other) : (k > other ? k : other);
+    }
+    while (k-- > 0)
+        mask &= mask - 1;
+    return __builtin_ctzll(mask);
+}
+
+// Fills pairs with the nodes of random walks, each node being a sumset of nodes (PAIRS of them)
+static void build_pairs(Pair* pairs, Sumset* nodes, InputData* input_data, int distribution)
+{
+    int d = input_data->d;
+    const Sumset* a = &input_data->a_start;
+    const Sumset* b = &input_data->b_start;
+    for (int n = 0; n < PAIRS;) {
+        const Sumset* small = (a->sum <= b->sum) ? a : b;
+        const Sumset* big = (a->sum <= b->sum) ? b : a;
+        Word trivial = 0;
+        for (Word candidates = sumset_missing_mask(big, small->last, d); candidates != 0; candidates &= candidates - 1) {
+            int x = __builtin_ctzll(candidates);
+            if (is_shifted_intersection_empty(small, big, x))
+                trivial |= (Word)1 << x;
+        }
+        // A leaf: the next walk starts from the root
+        if (trivial == 0) {
+            a = &input_data->a_start;
+            b = &input_data->b_start;
+            continue;
+        }
+
+        int x = draw(trivial, distribution);
+        sumset_add(&nodes[n], small, x);
+        a = &nodes[n];
+        b = big;
+        small = (a->sum <= b->sum) ? a : b;
+        big = (a->sum <= b->sum) ? b : a;
+        Word next = sumset_missing_mask(big, small->last, d);
+        pairs[n] = (Pair){ small, big, (next != 0) ? draw(next, distribution) : d, rand_r(&seed) % (small->sum + d + 1) };
+        n++;
+    }
+}
+
+static volatile size_t sink;
+static Sumset scratch;
+static Solution solution;
+static InputData* bench_input;
+
+// Each primitive is called once for every pair, its results go to sink so that the calls are kept
+#define PRIMITIVE(name, call)                            \
+    static void name(const Pair* pairs)                  \
+    {                                                    \
+        size_t result = 0;                               \
+        for (int i = 0; i < PAIRS; ++i) {                \
+            const Pair* p = &pairs[i];                   \
+            result += (call);                            \
+        }                                                \
+        sink += result;                                  \
+    }
+
+PRIMITIVE(bench_sumset_add, (sumset_add(&scratch, p->small, p->x), scratch.sumset[0]))
+PRIMITIVE(bench_trivial, is_sumset_intersection_trivial(p->small, p->big))
+PRIMITIVE(bench_intersection_size, get_sumset_intersection_size(p->small, p->big))
+PRIMITIVE(bench_contain, does_sumset_contain(p->small, p->value))
+PRIMITIVE(bench_shifted_empty, is_shifted_intersection_empty(p->small, p->big, p->x))
+PRIMITIVE(bench_solution_build, (solution_build(&solution, bench_input, p->small, p->big), solution.sum))
+
+static const struct {
+    const char* name;
+    void (*run)(const Pair* pairs);
+} primitives[] = {
+    { "sumset_add", bench_sumset_add },
+    { "is_sumset_intersection_trivial", bench_trivial },
+    { "get_sumset_intersection_size", bench_intersection_size },
+    { "does_sumset_contain", bench_contain },
+    { "is_shifted_intersection_empty", bench_shifted_empty },
+    { "solution_build", bench_solution_build },
+};
+
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int parse_number(const char* text, const char* name)
+{
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || value < 0)
+        fatal("%s needs a number", name);
+    return value;
+}
+
+int main(int argc, char* argv[])
+{
+    int d_values[MAX_VALUES] = { 10, 20, 30, 40, 50 };
+    int d_count = 5;
+    int samples = 200;
+    int warmup = 20;
+    int cpu = 0;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc)
+            fatal("Usage: %s [--d LIST] [--samples N] [--warmup N] [--cpu N]", argv[0]);
+        const char* option = argv[i++];
+        if (strcmp(option, "--d") == 0) {
+            d_count = 0;
+            for (char* value = strtok(argv[i], ","); value != NULL; value = strtok(NULL, ",")) {
+                int d = parse_number(value, option);
+                if (d < 3 || d > MAX_D || d_count == MAX_VALUES)
+                    fatal("--d needs at most %d values of d in 3..%d, separated by commas", MAX_VALUES, MAX_D);
+                d_values[d_count++] = d;
+            }
+            if (d_count == 0)
+                fatal("--d needs values of d");
+        } else if (strcmp(option, "--samples") == 0)
+            samples = parse_number(argv[i], option);
+        else if (strcmp(option, "--warmup") == 0)
+            warmup = parse_number(argv[i], option);
+        else if (strcmp(option, "--cpu") == 0)
+            cpu = parse_number(argv[i], option);
+        else
+            fatal("Unknown option: %s", option);
+    }
+    if (samples < 1 || samples > MAX_SAMPLES)
+        fatal("--samples must be in 1..%d", MAX_SAMPLES);
+
+    // Without migrations between CPUs, and their cold caches, in the samples
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    ASSERT_SYS_OK(sched_setaffinity(0, sizeof(cpus), &cpus));
+
+    Pair* pairs = malloc(sizeof(Pair) * PAIRS);
+    Sumset* nodes = malloc(sizeof(Sumset) * PAIRS);
+    double* times = malloc(sizeof(double) * samples);
+    InputData* input_data = malloc(sizeof(InputData));
+    if (!pairs || !nodes || !times || !input_data)
+        exit(1);
+    bench_input = input_data;
+
+    printf("primitive,d,distribution,kernels,calls,min_ns,p50_ns,p90_ns,p99_ns\n");
+    for (int i = 0; i < d_count; ++i) {
+        input_data_init(input_data, 1, d_values[i], (int[]){ 0 }, (int[]){ 1, 0 });
+        for (int distribution = 0; distribution < DISTRIBUTIONS; ++distribution) {
+            build_pairs(pairs, nodes, input_data, distribution);
+            for (size_t k = 0; k < sizeof(primitives) / sizeof(primitives[0]); ++k) {
+                for (int sample = -warmup; sample < samples; ++sample) {
+                    struct timespec start, end;
+                    clock_gettime(CLOCK_MONOTONIC, &start);
+                    primitives[k].run(pairs);
+                    clock_gettime(CLOCK_MONOTONIC, &end);
+                    if (sample >= 0)
+                        times[sample] = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / PAIRS;
+                }
+                qsort(times, samples, sizeof(double), compare_doubles);
+                printf("%s,%d,%s,%s,%d,%.2f,%.2f,%.2f,%.2f\n", primitives[k].name, d_values[i],
+                       distribution_names[distribution], _sumset_kernels.name, PAIRS, times[0],
+                       times[samples / 2], times[(int)(0.9 * (samples - 1))], times[(int)(0.99 * (samples - 1))]);
+            }
+        }
+    }
+
+    free(pairs);
+    free(nodes);
+    free(times);
+    free(input_data);
+    return 0;
+}
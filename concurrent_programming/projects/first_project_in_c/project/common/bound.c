@@ -0,0 +1,56 @@
+#include "common/bound.h"
+
+#include <stdbool.h>
+
+int alpha_ceiling(const InputData* input_data)
+{
+    int d = input_data->d;
+    if (input_data->a_in.count[1] > 0 || input_data->b_in.count[1] > 0)
+        return (d - 1) * (d - 1);
+    return d * (d - 1);
+}
+
+// Whether each element (up to d) occurs in a at least as many times as in b.
+static bool multiset_contains(const Multiset* a, const Multiset* b, int d)
+{
+    for (int i = 1; i <= d; i++) {
+        if (a->count[i] < b->count[i])
+            return false;
+    }
+    return true;
+}
+
+// Set s to the solution (a, b) if it contains the input multisets (in any order).
+static bool solution_try(Solution* s, const InputData* input_data, const Multiset* a, const Multiset* b, int sum)
+{
+    int d = input_data->d;
+    if (multiset_contains(a, &input_data->a_in, d) && multiset_contains(b, &input_data->b_in, d)) {
+        s->a = *a;
+        s->b = *b;
+    } else if (multiset_contains(b, &input_data->a_in, d) && multiset_contains(a, &input_data->b_in, d)) {
+        s->a = *b;
+        s->b = *a;
+    } else {
+        return false;
+    }
+    s->sum = sum;
+    return true;
+}
+
+void solution_seed(Solution* s, const InputData* input_data)
+{
+    int d = input_data->d;
+    solution_init(s);
+
+    Multiset a = { 0 }, b = { 0 };
+    a.count[d] = d - 1;
+    b.count[d - 1] = d;
+    if (solution_try(s, input_data, &a, &b, d * (d - 1)))
+        return;
+
+    a = b = (Multiset){ 0 };
+    a.count[1] = 1;
+    a.count[d] = d - 2;
+    b.count[d - 1] = d - 1;
+    solution_try(s, input_data, &a, &b, (d - 1) * (d - 1));
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include "common/io.h"
+
+// Known upper bound on α(d, A_0, B_0): α(d, ∅, {1}) = (d-1)^2 if 1 is in A_0 or B_0, otherwise α(d, ∅, ∅) = d(d-1).
+// No branch of the search can give a bigger sum, so a solution with this sum ends a search with --bound.
+int alpha_ceiling(const InputData* input_data);
+
+// Initialize a solution to the constructive solution from README which contains A_0 and B_0:
+//   A = {(d-1)x d},   B = {d x (d-1)}    with ΣA = d(d-1), or
+//   A = {1, (d-2)x d}, B = {(d-1)x (d-1)} with ΣA = (d-1)^2.
+// If neither contains the input multisets, this is an empty solution (sum 0).
+void solution_seed(Solution* s, const InputData* input_data);
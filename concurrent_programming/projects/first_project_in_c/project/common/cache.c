@@ -0,0 +1,137 @@
+#include "common/cache.h"
+#include "common/err.h"
+#include "common/transposition.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int cache_compare_keys(const uint64_t a[2], const uint64_t b[2])
+{
+    if (a[0] != b[0])
+        return (a[0] < b[0]) ? -1 : 1;
+    if (a[1] != b[1])
+        return (a[1] < b[1]) ? -1 : 1;
+    return 0;
+}
+
+static size_t tail_slot(const SubtreeCache* cache, const uint64_t key[2])
+{
+    return (key[0] ^ key[1] >> 17) & cache->tail_mask;
+}
+
+void cache_open(SubtreeCache* cache, const char* path, int d)
+{
+    cache->fd = -1;
+    cache->d = d;
+    cache->records = NULL;
+    cache->sorted = cache->count = 0;
+    cache->tail_index = NULL;
+    cache->tail_mask = 0;
+    if (path == NULL)
+        return;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd == -1)
+        syserr("Cannot open the cache %s", path);
+    struct stat st;
+    ASSERT_SYS_OK(fstat(fd, &st));
+
+    CacheHeader header;
+    if (st.st_size == 0) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+        if (write(fd, &header, sizeof(header)) != sizeof(header))
+            syserr("Cannot write the cache %s", path);
+        st.st_size = sizeof(header);
+    } else if (pread(fd, &header, sizeof(header), 0) != sizeof(header)
+               || memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0) {
+        fatal("%s is not a cache file", path);
+    }
+
+    // A record cut by an interrupted run is ignored
+    cache->count = (st.st_size - sizeof(header)) / sizeof(CacheRecord);
+    cache->sorted = header.sorted;
+    if (cache->sorted > cache->count)
+        fatal("%s is corrupted", path);
+    if (cache->count > 0) {
+        size_t length = sizeof(header) + cache->count * sizeof(CacheRecord);
+        void* map = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED)
+            syserr("Cannot map the cache %s", path);
+        cache->records = (const CacheRecord*)((const char*)map + sizeof(header));
+    }
+
+    // Index the tail, with at most half of the slots used
+    size_t tail = cache->count - cache->sorted;
+    size_t slots = 1;
+    while (slots < 2 * tail)
+        slots *= 2;
+    cache->tail_mask = slots - 1;
+    cache->tail_index = calloc(slots, sizeof(uint32_t));
+    if (cache->tail_index == NULL)
+        fatal("Cannot allocate the index of the cache %s", path);
+    for (size_t i = cache->sorted; i < cache->count; ++i) {
+        size_t slot = tail_slot(cache, cache->records[i].key);
+        while (cache->tail_index[slot] != 0)
+            slot = (slot + 1) & cache->tail_mask;
+        cache->tail_index[slot] = i - cache->sorted + 1;
+    }
+
+    ASSERT_ZERO(pthread_mutex_init(&cache->append_mutex, NULL));
+    cache->fd = fd;
+}
+
+void cache_close(SubtreeCache* cache)
+{
+    if (!cache_enabled(cache))
+        return;
+    if (cache->records != NULL)
+        munmap((char*)cache->records - sizeof(CacheHeader), sizeof(CacheHeader) + cache->count * sizeof(CacheRecord));
+    free(cache->tail_index);
+    ASSERT_ZERO(pthread_mutex_destroy(&cache->append_mutex));
+    ASSERT_SYS_OK(close(cache->fd));
+    cache->fd = -1;
+}
+
+int cache_lookup(const SubtreeCache* cache, const Sumset* a, const Sumset* b)
+{
+    if (cache->count == 0)
+        return -1;
+    uint64_t key[2];
+    state_hash(a, b, cache->d, key);
+
+    size_t low = 0, high = cache->sorted;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        int c = cache_compare_keys(cache->records[mid].key, key);
+        if (c == 0)
+            return cache->records[mid].best;
+        if (c < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    for (size_t slot = tail_slot(cache, key); cache->tail_index[slot] != 0; slot = (slot + 1) & cache->tail_mask) {
+        const CacheRecord* record = &cache->records[cache->sorted + cache->tail_index[slot] - 1];
+        if (cache_compare_keys(record->key, key) == 0)
+            return record->best;
+    }
+    return -1;
+}
+
+void cache_record(SubtreeCache* cache, const Sumset* a, const Sumset* b, int best)
+{
+    CacheRecord record = { .best = best, .unused = 0 };
+    state_hash(a, b, cache->d, record.key);
+
+    ASSERT_ZERO(pthread_mutex_lock(&cache->append_mutex));
+    // O_APPEND: the whole record goes to the end, after the records of other processes
+    if (write(cache->fd, &record, sizeof(record)) != sizeof(record))
+        syserr("Cannot append to the cache");
+    ASSERT_ZERO(pthread_mutex_unlock(&cache->append_mutex));
+}
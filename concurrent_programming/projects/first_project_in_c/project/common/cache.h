@@ -0,0 +1,62 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "common/sumset.h"
+
+// A file of results of subtrees of the search, kept across runs (--cache PATH, with --bound).
+//
+// A record maps a state (d, A^Σ, last of A, B^Σ, last of B) to the best sum of a solution in its subtree
+// (0 if there is none). The subtree only depends on the state, so the record is valid for every input reaching it.
+// A later run skips a subtree whose best sum can't beat its current best.
+//
+// The file is a header and records sorted by key, followed by an unsorted tail of records appended by the runs.
+// Runs map it read-only and append with write(), so records appended in a run are only seen by later runs.
+// cache_compact merges the tail into the sorted part (see cache_compact.c).
+
+#define CACHE_MAGIC "SUMSETC1"
+
+// The solvers only record subtrees with at least this many nodes, smaller ones are faster to search again
+#define CACHE_MIN_NODES 4096
+
+typedef struct CacheHeader {
+    char magic[8];
+    uint64_t sorted; // Number of sorted records at the start
+} CacheHeader;
+
+typedef struct CacheRecord {
+    uint64_t key[2]; // state_hash() of the state, with d as seed
+    int32_t best;
+    uint32_t unused;
+} CacheRecord;
+
+typedef struct SubtreeCache {
+    int fd; // -1 if the cache is disabled
+    int d;
+    const CacheRecord* records; // Mapped records from previous runs
+    size_t sorted, count;
+    uint32_t* tail_index; // Open addressing over records[sorted..count), 1 + position, 0 for empty
+    size_t tail_mask;
+    pthread_mutex_t append_mutex;
+} SubtreeCache;
+
+// Open (or create) the cache file at path, for the searches with the given d. Disabled if path is NULL.
+void cache_open(SubtreeCache* cache, const char* path, int d);
+
+void cache_close(SubtreeCache* cache);
+
+static inline bool cache_enabled(const SubtreeCache* cache)
+{
+    return cache->fd >= 0;
+}
+
+// Return the best sum in the subtree of (a, b) recorded by a previous run, or -1.
+int cache_lookup(const SubtreeCache* cache, const Sumset* a, const Sumset* b);
+
+// Append the best sum in the subtree of (a, b) to the file (thread-safe).
+void cache_record(SubtreeCache* cache, const Sumset* a, const Sumset* b, int best);
+
+// Compare record keys, for sorting and searching.
+int cache_compare_keys(const uint64_t a[2], const uint64_t b[2]);
@@ -0,0 +1,64 @@
+// Compacts a cache file of subtree results (see cache.h): sorts all records, keeps one per state,
+// and replaces the file atomically. Must not run while solvers append to the same file.
+// Usage: cache_compact PATH
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "common/cache.h"
+#include "common/err.h"
+
+static int compare_records(const void* a, const void* b)
+{
+    return cache_compare_keys(((const CacheRecord*)a)->key, ((const CacheRecord*)b)->key);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2)
+        fatal("Usage: %s PATH", argv[0]);
+    const char* path = argv[1];
+
+    FILE* in = fopen(path, "rb");
+    if (in == NULL)
+        syserr("Cannot open %s", path);
+    CacheHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0)
+        fatal("%s is not a cache file", path);
+    ASSERT_SYS_OK(fseek(in, 0, SEEK_END));
+    long size = ftell(in);
+    ASSERT_SYS_OK(size);
+    size_t count = (size - sizeof(header)) / sizeof(CacheRecord);
+    ASSERT_SYS_OK(fseek(in, sizeof(header), SEEK_SET));
+
+    CacheRecord* records = malloc(count * sizeof(CacheRecord) + 1);
+    if (records == NULL)
+        fatal("Cannot allocate %zu records", count);
+    if (fread(records, sizeof(CacheRecord), count, in) != count)
+        syserr("Cannot read %s", path);
+    fclose(in);
+
+    // The same state always has the same result, duplicates come from runs that overlapped
+    qsort(records, count, sizeof(CacheRecord), compare_records);
+    size_t unique = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (unique > 0 && compare_records(&records[unique - 1], &records[i]) == 0)
+            continue;
+        records[unique++] = records[i];
+    }
+
+    char temporary[strlen(path) + 5];
+    sprintf(temporary, "%s.tmp", path);
+    FILE* out = fopen(temporary, "wb");
+    if (out == NULL)
+        syserr("Cannot create %s", temporary);
+    header.sorted = unique;
+    if (fwrite(&header, sizeof(header), 1, out) != 1 || fwrite(records, sizeof(CacheRecord), unique, out) != unique
+        || fflush(out) != 0 || fsync(fileno(out)) != 0 || fclose(out) != 0)
+        syserr("Cannot write %s", temporary);
+    ASSERT_SYS_OK(rename(temporary, path));
+
+    printf("%zu records, %zu after compaction\n", count, unique);
+    free(records);
+    return 0;
+}
@@ -0,0 +1,336 @@
+#include "common/checkpoint.h"
+#include "common/err.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void checkpoint_init(Checkpoint* checkpoint)
+{
+    checkpoint->data = NULL;
+    checkpoint->size = checkpoint->capacity = 0;
+    checkpoint->frames = NULL;
+    checkpoint->frame_count = checkpoint->frame_capacity = 0;
+}
+
+void checkpoint_free(Checkpoint* checkpoint)
+{
+    free(checkpoint->data);
+    free(checkpoint->frames);
+    checkpoint_init(checkpoint);
+}
+
+static void* checkpoint_append(Checkpoint* checkpoint, size_t size)
+{
+    if (checkpoint->size + size > checkpoint->capacity) {
+        size_t capacity = (checkpoint->capacity == 0) ? 4096 : checkpoint->capacity;
+        while (checkpoint->size + size > capacity)
+            capacity *= 2;
+        checkpoint->data = realloc(checkpoint->data, capacity);
+        if (checkpoint->data == NULL)
+            exit(1);
+        checkpoint->capacity = capacity;
+    }
+    void* result = checkpoint->data + checkpoint->size;
+    checkpoint->size += size;
+    return result;
+}
+
+static void checkpoint_push_frame(Checkpoint* checkpoint, size_t offset)
+{
+    if (checkpoint->frame_count == checkpoint->frame_capacity) {
+        checkpoint->frame_capacity = (checkpoint->frame_capacity == 0) ? 64 : 2 * checkpoint->frame_capacity;
+        checkpoint->frames = realloc(checkpoint->frames, sizeof(size_t) * checkpoint->frame_capacity);
+        if (checkpoint->frames == NULL)
+            exit(1);
+    }
+    checkpoint->frames[checkpoint->frame_count++] = offset;
+}
+
+// Size of a frame in the file, padded so that the next header is aligned
+static size_t frame_size(const CheckpointFrameHeader* header)
+{
+    return sizeof(CheckpointFrameHeader) + ((header->a_length + header->b_length + 1) & ~1);
+}
+
+static CheckpointHeader* checkpoint_header(const Checkpoint* checkpoint)
+{
+    return (CheckpointHeader*)checkpoint->data;
+}
+
+// Starts the checkpoint over, with the header of the search and its best solution.
+static void checkpoint_begin(Checkpoint* checkpoint, const InputData* input_data, bool bound, int ceiling,
+                             const Solution* best_solution)
+{
+    checkpoint->size = 0;
+    checkpoint->frame_count = 0;
+    CheckpointHeader* header = checkpoint_append(checkpoint, sizeof(CheckpointHeader));
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic));
+    header->d = input_data->d;
+    header->bound = bound;
+    header->ceiling = ceiling;
+    header->best_sum = best_solution->sum;
+    for (int x = 0; x <= MAX_D; ++x) {
+        header->a_in[x] = input_data->a_in.count[x];
+        header->b_in[x] = input_data->b_in.count[x];
+        header->best_a[x] = best_solution->a.count[x];
+        header->best_b[x] = best_solution->b.count[x];
+    }
+}
+
+// Appends a frame with the elements given as counts per value.
+static void checkpoint_add_counts(Checkpoint* checkpoint, const int a_counts[MAX_D + 1], const int b_counts[MAX_D + 1],
+                                  int first, int end, bool extends_b)
+{
+    int a_length = 0, b_length = 0;
+    for (int x = 0; x <= MAX_D; ++x) {
+        a_length += a_counts[x];
+        b_length += b_counts[x];
+    }
+    checkpoint_push_frame(checkpoint, checkpoint->size);
+    CheckpointFrameHeader* header = checkpoint_append(checkpoint, sizeof(CheckpointFrameHeader));
+    *header = (CheckpointFrameHeader){ a_length, b_length, first, end, extends_b, 0 };
+    uint8_t* elements = checkpoint_append(checkpoint, frame_size(header) - sizeof(*header));
+    for (int x = 0; x <= MAX_D; ++x)
+        for (int k = 0; k < a_counts[x]; ++k)
+            *elements++ = x;
+    for (int x = 0; x <= MAX_D; ++x)
+        for (int k = 0; k < b_counts[x]; ++k)
+            *elements++ = x;
+    if ((a_length + b_length) % 2 != 0)
+        *elements = 0;
+}
+
+// Appends the frame k of from, starting at its child first.
+static void checkpoint_add_copy(Checkpoint* checkpoint, const Checkpoint* from, size_t k, int first)
+{
+    size_t size = frame_size((const CheckpointFrameHeader*)(from->data + from->frames[k]));
+    checkpoint_push_frame(checkpoint, checkpoint->size);
+    unsigned char* copy = checkpoint_append(checkpoint, size);
+    memcpy(copy, from->data + from->frames[k], size);
+    ((CheckpointFrameHeader*)copy)->first = first;
+}
+
+static void checkpoint_write(const Checkpoint* checkpoint, const char* path)
+{
+    checkpoint_header(checkpoint)->frame_count = checkpoint->frame_count;
+
+    // A run killed while writing leaves the previous checkpoint intact
+    char temporary[4096];
+    if (snprintf(temporary, sizeof(temporary), "%s.tmp", path) >= (int)sizeof(temporary))
+        fatal("Checkpoint path too long: %s", path);
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+        syserr("Cannot create the checkpoint %s", temporary);
+    size_t written = 0;
+    while (written < checkpoint->size) {
+        ssize_t result = write(fd, checkpoint->data + written, checkpoint->size - written);
+        if (result == -1)
+            syserr("Cannot write the checkpoint %s", temporary);
+        written += result;
+    }
+    ASSERT_SYS_OK(fsync(fd));
+    ASSERT_SYS_OK(close(fd));
+    if (rename(temporary, path) == -1)
+        syserr("Cannot replace the checkpoint %s", path);
+}
+
+void checkpoint_read(Checkpoint* checkpoint, const char* path, const InputData* input_data, bool bound, int ceiling,
+                     Solution* best_solution)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+        syserr("Cannot open the checkpoint %s", path);
+    struct stat st;
+    ASSERT_SYS_OK(fstat(fd, &st));
+    checkpoint->size = 0;
+    checkpoint->frame_count = 0;
+    unsigned char* data = checkpoint_append(checkpoint, st.st_size);
+    for (size_t done = 0; done < (size_t)st.st_size;) {
+        ssize_t result = read(fd, data + done, st.st_size - done);
+        if (result <= 0)
+            syserr("Cannot read the checkpoint %s", path);
+        done += result;
+    }
+    ASSERT_SYS_OK(close(fd));
+
+    const CheckpointHeader* header = checkpoint_header(checkpoint);
+    if (checkpoint->size < sizeof(*header) || memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0)
+        fatal("%s is not a checkpoint file", path);
+    bool same_input = header->d == input_data->d;
+    for (int x = 0; x <= MAX_D; ++x)
+        same_input &= header->a_in[x] == input_data->a_in.count[x] && header->b_in[x] == input_data->b_in.count[x];
+    if (!same_input)
+        fatal("The checkpoint %s is of another input", path);
+    if (header->bound != bound || header->ceiling != ceiling)
+        fatal("The checkpoint %s was written %s --bound", path, header->bound ? "with" : "without");
+
+    size_t offset = sizeof(*header);
+    for (uint32_t k = 0; k < header->frame_count; ++k) {
+        const CheckpointFrameHeader* frame = (const CheckpointFrameHeader*)(checkpoint->data + offset);
+        if (offset + sizeof(*frame) > checkpoint->size || offset + frame_size(frame) > checkpoint->size)
+            fatal("The checkpoint %s is truncated", path);
+        checkpoint_push_frame(checkpoint, offset);
+        offset += frame_size(frame);
+    }
+
+    if (header->best_sum > best_solution->sum) {
+        best_solution->sum = header->best_sum;
+        for (int x = 0; x <= MAX_D; ++x) {
+            best_solution->a.count[x] = header->best_a[x];
+            best_solution->b.count[x] = header->best_b[x];
+        }
+    }
+}
+
+CheckpointFrame checkpoint_frame(const Checkpoint* checkpoint, size_t k)
+{
+    const CheckpointFrameHeader* header = (const CheckpointFrameHeader*)(checkpoint->data + checkpoint->frames[k]);
+    const uint8_t* elements = (const uint8_t*)(header + 1);
+    return (CheckpointFrame){ elements, elements + header->a_length, header->a_length, header->b_length,
+                              header->first, header->end, header->extends_b };
+}
+
+// Writes the elements of the multiset followed by those of path and by x if it's not 0, terminated with 0.
+// Returns the last element of path and x (1 if none, as last of an initial sumset).
+static int elements_of(const Multiset* in, const uint8_t* path, int length, int x, int elements[])
+{
+    int count = 0;
+    for (int y = 0; y <= MAX_D; ++y)
+        for (int k = 0; k < in->count[y]; ++k)
+            elements[count++] = y;
+    int last = 1;
+    for (int k = 0; k < length; ++k)
+        elements[count++] = last = path[k];
+    if (x > 0)
+        elements[count++] = last = x;
+    elements[count] = 0;
+    return last;
+}
+
+void checkpoint_frame_input(const CheckpointFrame* frame, int x, const InputData* input_data, InputData* result)
+{
+    // All sums are below MAX_BITS, so is the number of elements
+    int a_elements[MAX_BITS + 2], b_elements[MAX_BITS + 2];
+    int a_last = elements_of(&input_data->a_in, frame->a, frame->a_length, frame->extends_b ? 0 : x, a_elements);
+    int b_last = elements_of(&input_data->b_in, frame->b, frame->b_length, frame->extends_b ? x : 0, b_elements);
+
+    // input_data_init() doesn't clear the count of MAX_D
+    memset(result, 0, sizeof(*result));
+    input_data_init(result, input_data->t, input_data->d, a_elements, b_elements);
+    result->a_start.last = a_last;
+    result->b_start.last = b_last;
+}
+
+static struct timespec now(void)
+{
+    struct timespec result;
+    ASSERT_SYS_OK(clock_gettime(CLOCK_MONOTONIC, &result));
+    return result;
+}
+
+void checkpointer_init(Checkpointer* checkpointer, const char* path, int seconds, const InputData* input_data,
+                       bool bound, int ceiling)
+{
+    checkpointer->path = path;
+    checkpointer->seconds = seconds;
+    checkpointer->last = now();
+    checkpointer->input_data = input_data;
+    checkpointer->bound = bound;
+    checkpointer->ceiling = ceiling;
+    checkpointer->roots = input_data;
+    checkpointer->resumed = NULL;
+    checkpointer->resumed_frame = 0;
+    checkpointer->resumed_next = 0;
+    checkpoint_init(&checkpointer->current);
+}
+
+void checkpointer_free(Checkpointer* checkpointer)
+{
+    checkpoint_free(&checkpointer->current);
+}
+
+bool checkpointer_due(const Checkpointer* checkpointer)
+{
+    struct timespec t = now();
+    return t.tv_sec - checkpointer->last.tv_sec > checkpointer->seconds
+        || (t.tv_sec - checkpointer->last.tv_sec == checkpointer->seconds
+            && t.tv_nsec >= checkpointer->last.tv_nsec);
+}
+
+void checkpointer_wait(const Checkpointer* checkpointer, pthread_cond_t* cond, pthread_mutex_t* mutex, bool later)
+{
+    struct timespec deadline = checkpointer->last;
+    deadline.tv_sec += checkpointer->seconds;
+    if (later && checkpointer_due(checkpointer)) {
+        deadline = now();
+        deadline.tv_sec += 1;
+    }
+    int result = pthread_cond_timedwait(cond, mutex, &deadline);
+    if (result != 0 && result != ETIMEDOUT) {
+        errno = result;
+        syserr("pthread_cond_timedwait");
+    }
+}
+
+void checkpointer_begin(Checkpointer* checkpointer, const Solution* best_solution)
+{
+    checkpoint_begin(&checkpointer->current, checkpointer->input_data, checkpointer->bound, checkpointer->ceiling,
+                     best_solution);
+}
+
+// Counts the elements added on the way to s, returns the initial sumset.
+static const Sumset* count_added(const Sumset* s, int counts[MAX_D + 1])
+{
+    for (; s->prev != NULL; s = s->prev)
+        counts[s->sum - s->prev->sum]++;
+    return s;
+}
+
+void checkpointer_add(Checkpointer* checkpointer, const Sumset* a, const Sumset* b, int first, int end)
+{
+    if (first > end)
+        return;
+    int a_counts[MAX_D + 1] = { 0 }, b_counts[MAX_D + 1] = { 0 };
+    const Sumset* a_root = count_added(a, a_counts);
+    const Sumset* b_root = count_added(b, b_counts);
+    bool a_is_a = a_root == &checkpointer->roots->a_start;
+    if (!(a_is_a && b_root == &checkpointer->roots->b_start)
+        && !(a_root == &checkpointer->roots->b_start && b_root == &checkpointer->roots->a_start))
+        fatal("A checkpoint frame doesn't start from the initial sumsets");
+
+    // The elements already in the roots which are not in the input are a part of the path
+    int* as = a_is_a ? a_counts : b_counts;
+    int* bs = a_is_a ? b_counts : a_counts;
+    for (int x = 0; x <= MAX_D; ++x) {
+        as[x] += checkpointer->roots->a_in.count[x] - checkpointer->input_data->a_in.count[x];
+        bs[x] += checkpointer->roots->b_in.count[x] - checkpointer->input_data->b_in.count[x];
+    }
+    checkpoint_add_counts(&checkpointer->current, as, bs, first, end, !a_is_a);
+}
+
+void checkpointer_commit(Checkpointer* checkpointer)
+{
+    const Checkpoint* resumed = checkpointer->resumed;
+    if (resumed != NULL && checkpointer->resumed_frame < resumed->frame_count) {
+        size_t k = checkpointer->resumed_frame;
+        CheckpointFrame frame = checkpoint_frame(resumed, k);
+        if (frame.first > 0 && checkpointer->resumed_next <= frame.end)
+            checkpoint_add_copy(&checkpointer->current, resumed, k, checkpointer->resumed_next);
+        for (++k; k < resumed->frame_count; ++k)
+            checkpoint_add_copy(&checkpointer->current, resumed, k, checkpoint_frame(resumed, k).first);
+    }
+    checkpoint_write(&checkpointer->current, checkpointer->path);
+    checkpointer->last = now();
+}
+
+void checkpointer_finish(Checkpointer* checkpointer)
+{
+    if (checkpointer_enabled(checkpointer) && unlink(checkpointer->path) == -1 && errno != ENOENT)
+        syserr("Cannot remove the checkpoint %s", checkpointer->path);
+}
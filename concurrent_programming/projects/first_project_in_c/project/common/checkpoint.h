@@ -0,0 +1,121 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "common/io.h"
+
+// Checkpoints of a search (--checkpoint PATH, continued with --resume).
+//
+// A checkpoint holds the best solution so far and the frontier of the search: the subtrees not searched yet.
+// A frame of the frontier is a node, given by the elements added to A_0 and to B_0 on the path from the root,
+// and either the node itself or its children a + x for first <= x <= end, where a is one of its sumsets.
+// The elements of each side are added in increasing order by the search, so they are stored sorted, and the last
+// one is the `last` of the sumset. There are no pointers, so any solver can resume with any number of threads.
+//
+// The file is a CheckpointHeader followed by frame_count frames, each a CheckpointFrameHeader followed by its
+// elements (a_length for A, then b_length for B). It is replaced atomically (written to PATH.tmp and renamed).
+
+#define CHECKPOINT_MAGIC "SUMSETK1"
+
+typedef struct CheckpointHeader {
+    char magic[8];
+    // The search: the checkpoint can only be resumed with the same input and mode
+    int32_t d, bound, ceiling;
+    uint16_t a_in[MAX_D + 1], b_in[MAX_D + 1];
+    // The best solution found before the checkpoint
+    int32_t best_sum;
+    uint16_t best_a[MAX_D + 1], best_b[MAX_D + 1];
+    uint32_t frame_count;
+} CheckpointHeader;
+
+typedef struct CheckpointFrameHeader {
+    uint16_t a_length, b_length;
+    uint8_t first, end; // The children first..end, or the node itself if first is 0
+    uint8_t extends_b; // Whether the children add x to B rather than to A
+    uint8_t unused;
+} CheckpointFrameHeader;
+
+// A frame of a checkpoint in memory
+typedef struct CheckpointFrame {
+    const uint8_t *a, *b; // The elements added to A_0 and to B_0, sorted
+    int a_length, b_length;
+    int first, end;
+    bool extends_b;
+} CheckpointFrame;
+
+// A checkpoint in memory, serialized as in the file
+typedef struct Checkpoint {
+    unsigned char* data;
+    size_t size, capacity;
+    size_t* frames; // Offsets of the frames in data
+    size_t frame_count, frame_capacity;
+} Checkpoint;
+
+void checkpoint_init(Checkpoint* checkpoint);
+
+void checkpoint_free(Checkpoint* checkpoint);
+
+// Reads the checkpoint at path, which must be of the search from input with the same bound and ceiling.
+// Sets best_solution to its best solution if that is better.
+void checkpoint_read(Checkpoint* checkpoint, const char* path, const InputData* input_data, bool bound, int ceiling,
+                     Solution* best_solution);
+
+// Returns the frame k of the checkpoint.
+CheckpointFrame checkpoint_frame(const Checkpoint* checkpoint, size_t k);
+
+// Sets result to input_data with the elements of the frame's node added to A_0 and B_0, and also x to the extended
+// side if x > 0: the start sumsets are the node, or its child, with last as in the search.
+void checkpoint_frame_input(const CheckpointFrame* frame, int x, const InputData* input_data, InputData* result);
+
+// Builds checkpoints of a search and writes them every few seconds.
+typedef struct Checkpointer {
+    const char* path; // NULL if disabled
+    int seconds;
+    struct timespec last; // When the last checkpoint was written (or the search started)
+    const InputData* input_data;
+    bool bound;
+    int ceiling;
+    // The input whose start sumsets the chains of the running search end at. Its A_0 and B_0 can have more elements
+    // than those of input_data (when resuming a frame), which are then part of the paths.
+    const InputData* roots;
+    // With --resume: the frames of the resumed checkpoint not started yet, from the children next of frame
+    // (and the frames after it)
+    const Checkpoint* resumed;
+    size_t resumed_frame;
+    int resumed_next;
+    Checkpoint current;
+} Checkpointer;
+
+// Disabled if path is NULL.
+void checkpointer_init(Checkpointer* checkpointer, const char* path, int seconds, const InputData* input_data,
+                       bool bound, int ceiling);
+
+void checkpointer_free(Checkpointer* checkpointer);
+
+static inline bool checkpointer_enabled(const Checkpointer* checkpointer)
+{
+    return checkpointer->path != NULL;
+}
+
+// Returns whether the interval has passed since the last checkpoint.
+bool checkpointer_due(const Checkpointer* checkpointer);
+
+// Waits on cond (with mutex locked, cond on the monotonic clock) until it's signaled or a checkpoint is due,
+// With later, a checkpoint that is already due waits another second (while it can't be written yet).
+void checkpointer_wait(const Checkpointer* checkpointer, pthread_cond_t* cond, pthread_mutex_t* mutex, bool later);
+
+// Starts a checkpoint with the best solution so far.
+void checkpointer_begin(Checkpointer* checkpointer, const Solution* best_solution);
+
+// Adds the children a + x, first <= x <= end (or the node (a, b) itself if first is 0) to the checkpoint.
+// The chains of a and b end at the start sumsets of checkpointer->roots.
+void checkpointer_add(Checkpointer* checkpointer, const Sumset* a, const Sumset* b, int first, int end);
+
+// Adds the frames of the resumed checkpoint not started yet, and writes the checkpoint to the file.
+void checkpointer_commit(Checkpointer* checkpointer);
+
+// Removes the file once the search is finished.
+void checkpointer_finish(Checkpointer* checkpointer);
@@ -0,0 +1,74 @@
+#include "common/deadline.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include "common/err.h"
+
+atomic_bool _deadline_passed;
+static atomic_bool stopped;
+static bool enabled;
+static struct timespec deadline;
+static void (*deadline_before_stop)(void);
+
+// As ASSERT_ZERO, which can't be used next to errno.h (needed for EINTR)
+static void check(int result, const char* what)
+{
+    if (result != 0) {
+        errno = result;
+        syserr("%s", what);
+    }
+}
+
+static void* deadline_timer(void* arg)
+{
+    // Restarted after signal handlers
+    int result;
+    while ((result = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL)) == EINTR)
+        ;
+    check(result, "clock_nanosleep");
+    if (deadline_before_stop != NULL)
+        deadline_before_stop();
+    atomic_store(&_deadline_passed, true);
+    return NULL;
+}
+
+void deadline_start(int milliseconds, void (*before_stop)(void))
+{
+    if (milliseconds <= 0)
+        return;
+    enabled = true;
+    deadline_before_stop = before_stop;
+    ASSERT_SYS_OK(clock_gettime(CLOCK_MONOTONIC, &deadline));
+    deadline.tv_sec += milliseconds / 1000;
+    deadline.tv_nsec += (long)(milliseconds % 1000) * 1000 * 1000;
+    if (deadline.tv_nsec >= 1000 * 1000 * 1000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000 * 1000 * 1000;
+    }
+
+    // Detached: the solver exits without waiting for it
+    pthread_t thread;
+    pthread_attr_t attr;
+    check(pthread_attr_init(&attr), "pthread_attr_init");
+    check(pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED), "pthread_attr_setdetachstate");
+    check(pthread_create(&thread, &attr, deadline_timer, NULL), "pthread_create");
+    check(pthread_attr_destroy(&attr), "pthread_attr_destroy");
+}
+
+void deadline_stop(void)
+{
+    atomic_store_explicit(&stopped, true, memory_order_relaxed);
+}
+
+bool deadline_stopped(void)
+{
+    return atomic_load(&stopped);
+}
+
+void deadline_print(void)
+{
+    if (enabled)
+        printf("%s\n", deadline_stopped() ? "deadline" : "exhaustive");
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// The time limit of --deadline-ms (in nonrecursive and parallel). A timer thread sets a flag when it passes,
+// the searches read it in their loops and stop, and the solver prints the best solution found so far followed by
+// a line "exhaustive" (the whole search was done) or "deadline" (it was stopped, the solution may not be optimal).
+
+extern atomic_bool _deadline_passed;
+
+// Starts the timer, milliseconds from now. Without a call (or with 0) there is no deadline.
+// before_stop (or NULL) is called by the timer thread when the deadline passes, before the flag is set.
+void deadline_start(int milliseconds, void (*before_stop)(void));
+
+// Whether the deadline passed: a relaxed load, cheap enough for the hot loops.
+static inline bool deadline_passed(void)
+{
+    return atomic_load_explicit(&_deadline_passed, memory_order_relaxed);
+}
+
+// Records that a search stopped before its end because of the deadline.
+void deadline_stop(void);
+
+// Whether a search stopped because of the deadline.
+bool deadline_stopped(void);
+
+// With a deadline, prints the line "exhaustive" or "deadline" to stdout (after the solution).
+void deadline_print(void);
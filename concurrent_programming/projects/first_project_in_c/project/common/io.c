@@ -127,7 +127,7 @@ void solution_build(Solution* s, InputData* input_data, const Sumset* a, const S
 }
 
 // Print a multiset, like: "2x1 3\n" for {1, 1, 3}.
-static void multiset_print(const Multiset* v)
+static void multiset_print(FILE* file, const Multiset* v)
 {
     bool first = true;
     for (int i = 0; i < MAX_D; i++) {
@@ -135,18 +135,23 @@ static void multiset_print(const Multiset* v)
             if (first)
                 first = false;
             else
-                printf(" ");
+                fprintf(file, " ");
             if (v->count[i] > 1)
-                printf("%dx", v->count[i]);
-            printf("%d", i);
+                fprintf(file, "%dx", v->count[i]);
+            fprintf(file, "%d", i);
         }
     }
-    printf("\n");
+    fprintf(file, "\n");
+}
+
+void solution_fprint(FILE* file, const Solution* s)
+{
+    fprintf(file, "%d\n", s->sum);
+    multiset_print(file, &s->a);
+    multiset_print(file, &s->b);
 }
 
 void solution_print(const Solution* s)
 {
-    printf("%d\n", s->sum);
-    multiset_print(&s->a);
-    multiset_print(&s->b);
+    solution_fprint(stdout, s);
 }
\ No newline at end of file
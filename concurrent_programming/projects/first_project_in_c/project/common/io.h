@@ -1,4 +1,5 @@
 #pragma once
+#include <stdio.h>
 #include "common/sumset.h"
 
 typedef struct Multiset {
@@ -52,3 +53,6 @@ void solution_build(Solution* s, InputData* input_data, const Sumset* a, const S
 
 // Prints the solution to stdout as required.
 void solution_print(const Solution* s);
+
+// Prints the solution to file, in the format of solution_print().
+void solution_fprint(FILE* file, const Solution* s);
@@ -0,0 +1,77 @@
+#include "common/options.h"
+#include "common/err.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void options_parse(Options* options, int argc, char* argv[])
+{
+    options->bound = false;
+    options->generic = false;
+    options->table_mib = 0;
+    options->cache_path = NULL;
+    options->checkpoint_path = NULL;
+    options->checkpoint_seconds = 60;
+    options->resume = false;
+    options->deadline_ms = 0;
+    options->progress_seconds = 0;
+    options->sweep = false;
+    options->batch = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bound") == 0)
+            options->bound = true;
+        else if (strcmp(argv[i], "--generic") == 0)
+            options->generic = true;
+        else if (strcmp(argv[i], "--table-mib") == 0) {
+            char* end = NULL;
+            if (i + 1 < argc)
+                options->table_mib = strtoul(argv[++i], &end, 10);
+            if (end == NULL || end == argv[i] || *end != '\0')
+                fatal("--table-mib needs a number of MiB");
+        } else if (strcmp(argv[i], "--cache") == 0) {
+            if (i + 1 == argc)
+                fatal("--cache needs a path");
+            options->cache_path = argv[++i];
+        } else if (strcmp(argv[i], "--checkpoint") == 0) {
+            if (i + 1 == argc)
+                fatal("--checkpoint needs a path");
+            options->checkpoint_path = argv[++i];
+        } else if (strcmp(argv[i], "--checkpoint-seconds") == 0) {
+            char* end = NULL;
+            if (i + 1 < argc)
+                options->checkpoint_seconds = strtol(argv[++i], &end, 10);
+            if (end == NULL || end == argv[i] || *end != '\0' || options->checkpoint_seconds <= 0)
+                fatal("--checkpoint-seconds needs a positive number of seconds");
+        } else if (strcmp(argv[i], "--deadline-ms") == 0) {
+            char* end = NULL;
+            if (i + 1 < argc)
+                options->deadline_ms = strtol(argv[++i], &end, 10);
+            if (end == NULL || end == argv[i] || *end != '\0' || options->deadline_ms <= 0)
+                fatal("--deadline-ms needs a positive number of milliseconds");
+        } else if (strcmp(argv[i], "--progress-seconds") == 0) {
+            char* end = NULL;
+            if (i + 1 < argc)
+                options->progress_seconds = strtol(argv[++i], &end, 10);
+            if (end == NULL || end == argv[i] || *end != '\0' || options->progress_seconds <= 0)
+                fatal("--progress-seconds needs a positive number of seconds");
+        } else if (strcmp(argv[i], "--resume") == 0)
+            options->resume = true;
+        else if (strcmp(argv[i], "--sweep") == 0)
+            options->sweep = true;
+        else if (strcmp(argv[i], "--batch") == 0)
+            options->batch = true;
+        else
+            fatal("Unknown option: %s", argv[i]);
+    }
+    // Without --bound the solvers must visit every node, as the reference implementation does
+    if (options->cache_path != NULL && !options->bound)
+        fatal("--cache needs --bound");
+    if (options->resume && options->checkpoint_path == NULL)
+        fatal("--resume needs --checkpoint");
+    // The files and the table are of one search
+    if (options->batch && (options->cache_path != NULL || options->checkpoint_path != NULL || options->table_mib > 0
+                           || options->deadline_ms > 0 || options->progress_seconds > 0))
+        fatal("--batch can't be used with --cache, --checkpoint, --table-mib, --deadline-ms or --progress-seconds");
+    if (options->sweep && (options->cache_path != NULL || options->checkpoint_path != NULL || options->deadline_ms > 0))
+        fatal("--sweep can't be used with --cache, --checkpoint or --deadline-ms");
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Command line options of the solvers (the task itself is always read from stdin).
+typedef struct Options {
+    // --bound: only compute α(d, A_0, B_0) and one witness, pruning branches that can't improve the best sum.
+    // Without it the solvers traverse all branches, exactly as the reference implementation does.
+    bool bound;
+    // --generic: in nonrecursive, use the search compiled for MAX_WORDS instead of the one specialized for d
+    // (for comparisons, see nonrecursive/CMakeLists.txt).
+    bool generic;
+    // --table-mib N: with --bound, memory for the table of visited states in parallel (see common/transposition.h).
+    // 0 (the default) disables it.
+    size_t table_mib;
+    // --cache PATH: with --bound, skip subtrees whose results are recorded in the file at PATH by previous runs,
+    // and record the results of big subtrees there (see common/cache.h). NULL (the default) disables it.
+    const char* cache_path;
+    // --checkpoint PATH: in nonrecursive and parallel, write the frontier of the search and the best solution
+    // to PATH every --checkpoint-seconds N (60 by default), see common/checkpoint.h. The file is removed when
+    // the search finishes. NULL (the default) disables it.
+    const char* checkpoint_path;
+    int checkpoint_seconds;
+    // --resume: continue the search from the checkpoint at the --checkpoint path instead of starting it over.
+    bool resume;
+    // --deadline-ms N: in nonrecursive and parallel, stop the search after N ms and print the best solution so far,
+    // followed by whether the search was exhaustive (see common/deadline.h). 0 (the default) disables it.
+    int deadline_ms;
+    // --progress-seconds N: in parallel, print the estimated progress of the search and the time left to stderr
+    // every N seconds (see common/progress.h). 0 (the default) disables it.
+    int progress_seconds;
+    // --sweep: in nonrecursive, print α(d, A_0, B_0) for every d up to the d of the input, from one search
+    // (see nonrecursive/sweep.h).
+    bool sweep;
+    // --batch: in parallel, solve a stream of instances with one pool of threads (see parallel/batch.h).
+    bool batch;
+} Options;
+
+// Parse the command line into options, quit with an error on unknown options.
+void options_parse(Options* options, int argc, char* argv[]);
@@ -0,0 +1,110 @@
+#define _GNU_SOURCE
+#include "common/progress.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+#include "common/err.h"
+
+static pthread_t reporter;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stop_cond; // On the monotonic clock
+static bool started, stopping;
+static int interval;
+static void (*progress_sample)(ProgressSample* sample);
+static struct timespec start;
+
+// As ASSERT_ZERO, which can't be used next to errno.h (needed for ETIMEDOUT)
+static void check(int result, const char* what)
+{
+    if (result != 0) {
+        errno = result;
+        syserr("%s", what);
+    }
+}
+
+static double seconds_since(const struct timespec* since)
+{
+    struct timespec now;
+    ASSERT_SYS_OK(clock_gettime(CLOCK_MONOTONIC, &now));
+    return (now.tv_sec - since->tv_sec) + (now.tv_nsec - since->tv_nsec) / 1e9;
+}
+
+// Prints seconds as h:mm:ss.
+static void print_duration(double seconds)
+{
+    long s = seconds + 0.5;
+    fprintf(stderr, "%ld:%02ld:%02ld", s / 3600, s / 60 % 60, s % 60);
+}
+
+static void report(void)
+{
+    ProgressSample sample = { 0, 0, 0 };
+    progress_sample(&sample);
+    double elapsed = seconds_since(&start);
+    fprintf(stderr, "progress: ");
+    print_duration(elapsed);
+    if (sample.total > 0)
+        fprintf(stderr, ", %.1f%% done", 100 * sample.done / sample.total);
+    else
+        fprintf(stderr, ", estimating");
+    fprintf(stderr, ", %.3g nodes/s, ETA ", sample.nodes / elapsed);
+    // The work done so far is assumed to go on at the same rate
+    if (sample.total > 0 && sample.done > 0)
+        print_duration(elapsed * (sample.total - sample.done) / sample.done);
+    else
+        fprintf(stderr, "unknown");
+    fprintf(stderr, "\n");
+}
+
+static void* reporter_thread(void* arg)
+{
+    // Only runs when a CPU would be idle otherwise, so the search isn't slowed down
+    check(pthread_setschedparam(pthread_self(), SCHED_IDLE, &(struct sched_param){ 0 }), "pthread_setschedparam");
+    struct timespec next = start;
+    check(pthread_mutex_lock(&mutex), "pthread_mutex_lock");
+    while (true) {
+        next.tv_sec += interval;
+        int result = 0;
+        while (!stopping && result == 0)
+            result = pthread_cond_timedwait(&stop_cond, &mutex, &next);
+        if (stopping)
+            break;
+        if (result != ETIMEDOUT)
+            check(result, "pthread_cond_timedwait");
+        report();
+    }
+    check(pthread_mutex_unlock(&mutex), "pthread_mutex_unlock");
+    return NULL;
+}
+
+void progress_start(int seconds, void (*sample)(ProgressSample* sample))
+{
+    if (seconds <= 0)
+        return;
+    interval = seconds;
+    progress_sample = sample;
+    ASSERT_SYS_OK(clock_gettime(CLOCK_MONOTONIC, &start));
+    pthread_condattr_t attr;
+    check(pthread_condattr_init(&attr), "pthread_condattr_init");
+    check(pthread_condattr_setclock(&attr, CLOCK_MONOTONIC), "pthread_condattr_setclock");
+    check(pthread_cond_init(&stop_cond, &attr), "pthread_cond_init");
+    check(pthread_condattr_destroy(&attr), "pthread_condattr_destroy");
+    check(pthread_create(&reporter, NULL, reporter_thread, NULL), "pthread_create");
+    started = true;
+}
+
+void progress_stop(void)
+{
+    if (!started)
+        return;
+    check(pthread_mutex_lock(&mutex), "pthread_mutex_lock");
+    stopping = true;
+    check(pthread_cond_signal(&stop_cond), "pthread_cond_signal");
+    check(pthread_mutex_unlock(&mutex), "pthread_mutex_unlock");
+    check(pthread_join(reporter, NULL), "pthread_join");
+    check(pthread_cond_destroy(&stop_cond), "pthread_cond_destroy");
+}
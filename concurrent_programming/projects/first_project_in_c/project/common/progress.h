@@ -0,0 +1,16 @@
+#pragma once
+
+// Reports the progress of a long search (--progress-seconds N in parallel). Every N seconds a thread of the lowest
+// priority samples the solver and prints to stderr the estimated fraction of the search done, the nodes per second
+// and the estimated time left. The searching threads only count in their own counters, the sample sums them.
+
+typedef struct ProgressSample {
+    double done, total; // Estimated work done and in the whole search, total is 0 while it's not known yet
+    long nodes; // Nodes visited so far
+} ProgressSample;
+
+// Starts the reporter, sample fills in the progress so far. With seconds 0 there is none.
+void progress_start(int seconds, void (*sample)(ProgressSample* sample));
+
+// Stops the reporter (if started), before the solution is printed.
+void progress_stop(void);
@@ -0,0 +1,112 @@
+#define _GNU_SOURCE
+#include "common/socket.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "common/err.h"
+
+bool socket_send(int fd, const void* data, size_t size)
+{
+    const char* bytes = data;
+    while (size > 0) {
+        // MSG_NOSIGNAL: a closed connection is reported as EPIPE, not SIGPIPE
+        ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+        if (sent == -1 && errno == EINTR)
+            continue;
+        if (sent == -1 && (errno == EPIPE || errno == ECONNRESET))
+            return false;
+        ASSERT_SYS_OK(sent);
+        bytes += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+bool socket_receive(int fd, void* data, size_t size)
+{
+    char* bytes = data;
+    while (size > 0) {
+        ssize_t received = recv(fd, bytes, size, 0);
+        if (received == -1 && errno == EINTR)
+            continue;
+        if (received == 0 || (received == -1 && errno == ECONNRESET))
+            return false;
+        ASSERT_SYS_OK(received);
+        bytes += received;
+        size -= received;
+    }
+    return true;
+}
+
+static struct sockaddr_un socket_address(const char* path)
+{
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(address.sun_path))
+        fatal("Socket path too long: %s", path);
+    strcpy(address.sun_path, path);
+    return address;
+}
+
+int socket_listen(const char* path)
+{
+    struct sockaddr_un address = socket_address(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    ASSERT_SYS_OK(fd);
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) == -1)
+        syserr("Cannot bind %s", path);
+    ASSERT_SYS_OK(listen(fd, SOMAXCONN));
+    return fd;
+}
+
+int socket_connect(const char* path)
+{
+    struct sockaddr_un address = socket_address(path);
+    // The client can be started before the server listens
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        ASSERT_SYS_OK(fd);
+        if (connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0)
+            return fd;
+        if (errno != ENOENT && errno != ECONNREFUSED)
+            syserr("Cannot connect to %s", path);
+        ASSERT_SYS_OK(close(fd));
+        nanosleep(&(struct timespec){ 0, 100 * 1000 * 1000 }, NULL);
+    }
+    fatal("Nothing listens at %s", path);
+}
+
+int socket_receive_all(int fd, char* data, size_t capacity)
+{
+    size_t length = 0;
+    while (true) {
+        ssize_t received = recv(fd, data + length, capacity - 1 - length, 0);
+        if (received == -1 && errno == EINTR)
+            continue;
+        if (received == -1 && errno == ECONNRESET)
+            received = 0;
+        ASSERT_SYS_OK(received);
+        if (received == 0)
+            break;
+        length += received;
+        if (length == capacity - 1)
+            return -1;
+    }
+    data[length] = '\0';
+    return length;
+}
+
+int socket_accept(int listener)
+{
+    while (true) {
+        int fd = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+        // The client gave up before being accepted
+        if (fd == -1 && (errno == EINTR || errno == ECONNABORTED))
+            continue;
+        ASSERT_SYS_OK(fd);
+        return fd;
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Blocking I/O on Unix domain stream sockets, shared by sharded and the daemon.
+
+// Sends size bytes. Returns false if the other side closed the connection.
+bool socket_send(int fd, const void* data, size_t size);
+
+// Receives size bytes. Returns false if the other side closed the connection first.
+bool socket_receive(int fd, void* data, size_t size);
+
+// Binds and listens on a socket at path (which must not exist). Returns its descriptor.
+int socket_listen(const char* path);
+
+// Connects to the socket at path, waiting up to 10 s for it to appear. Returns its descriptor.
+int socket_connect(const char* path);
+
+// Receives until the other side shuts down its side of the connection, at most capacity - 1 bytes, and ends them
+// with '\0'. Returns their number, or -1 if there were more.
+int socket_receive_all(int fd, char* data, size_t capacity);
+
+// Accepts the next connection on listener. Returns its descriptor.
+int socket_accept(int listener);
@@ -0,0 +1,167 @@
+#include "common/stats.h"
+
+#ifdef SOLVER_STATS
+
+#include "common/err.h"
+
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static SolverStats scratch;
+_Thread_local SolverStats* _solver_stats = &scratch;
+
+// All threads' counters, newest first
+static SolverStats* all_stats = NULL;
+static int thread_count = 0;
+static pthread_mutex_t all_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* const stat_names[STAT_COUNT] = {
+    [STAT_SUMSET_ADD] = "sumset_add",
+    [STAT_TRIVIAL] = "trivial",
+    [STAT_NONTRIVIAL] = "nontrivial",
+    [STAT_SOLUTION] = "solutions",
+    [STAT_IMPROVEMENT] = "improved",
+    [STAT_TASK] = "tasks",
+    [STAT_STEAL] = "steals",
+};
+
+static const char* const perf_names[PERF_COUNT] = {
+    [PERF_CYCLES] = "cycles",
+    [PERF_INSTRUCTIONS] = "instructions",
+    [PERF_L1D_MISSES] = "L1d_misses",
+    [PERF_LLC_MISSES] = "LLC_misses",
+    [PERF_BRANCH_MISSES] = "branch_misses",
+};
+
+static bool perf_requested(void)
+{
+    const char* value = getenv("SOLVER_STATS");
+    return value != NULL && strcmp(value, "perf") == 0;
+}
+
+// Count the event for the current thread only, on any CPU. Returns -1 if it can't be measured.
+static int perf_open(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void stats_thread_start(void)
+{
+    SolverStats* stats = aligned_alloc(alignof(SolverStats), sizeof(SolverStats));
+    if (stats == NULL)
+        fatal("Cannot allocate the counters of a thread");
+    memset(stats, 0, sizeof(*stats));
+    for (int e = 0; e < PERF_COUNT; ++e)
+        stats->perf_fds[e] = -1;
+
+    if (perf_requested()) {
+        stats->perf_fds[PERF_CYCLES] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        stats->perf_fds[PERF_INSTRUCTIONS] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        stats->perf_fds[PERF_L1D_MISSES] = perf_open(PERF_TYPE_HW_CACHE,
+            PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        stats->perf_fds[PERF_LLC_MISSES] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        stats->perf_fds[PERF_BRANCH_MISSES] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        for (int e = 0; e < PERF_COUNT; ++e) {
+            if (stats->perf_fds[e] >= 0) {
+                ioctl(stats->perf_fds[e], PERF_EVENT_IOC_RESET, 0);
+                ioctl(stats->perf_fds[e], PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    ASSERT_ZERO(pthread_mutex_lock(&all_stats_mutex));
+    stats->thread = thread_count++;
+    stats->next = all_stats;
+    all_stats = stats;
+    ASSERT_ZERO(pthread_mutex_unlock(&all_stats_mutex));
+    _solver_stats = stats;
+}
+
+void stats_thread_stop(void)
+{
+    SolverStats* stats = _solver_stats;
+    for (int e = 0; e < PERF_COUNT; ++e) {
+        if (stats->perf_fds[e] < 0)
+            continue;
+        ioctl(stats->perf_fds[e], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(stats->perf_fds[e], &stats->perf[e], sizeof(uint64_t)) != sizeof(uint64_t))
+            stats->perf[e] = 0;
+        close(stats->perf_fds[e]);
+    }
+    // perf_fds are kept to tell which events were measured
+    _solver_stats = &scratch;
+}
+
+// Events that weren't measured (for example without access to the PMU) are printed as "-".
+static void print_row(const char* label, const uint64_t count[STAT_COUNT], const uint64_t perf[PERF_COUNT],
+                      const bool measured[PERF_COUNT], bool with_perf)
+{
+    fprintf(stderr, "%-8s", label);
+    for (int s = 0; s < STAT_COUNT; ++s)
+        fprintf(stderr, " %14llu", (unsigned long long)count[s]);
+    if (with_perf) {
+        for (int e = 0; e < PERF_COUNT; ++e) {
+            if (measured[e])
+                fprintf(stderr, " %14llu", (unsigned long long)perf[e]);
+            else
+                fprintf(stderr, " %14s", "-");
+        }
+    }
+    fprintf(stderr, "\n");
+}
+
+void stats_print(void)
+{
+    if (getenv("SOLVER_STATS") == NULL)
+        return;
+
+    bool with_perf = perf_requested();
+    fprintf(stderr, "%-8s", "thread");
+    for (int s = 0; s < STAT_COUNT; ++s)
+        fprintf(stderr, " %14s", stat_names[s]);
+    if (with_perf)
+        for (int e = 0; e < PERF_COUNT; ++e)
+            fprintf(stderr, " %14s", perf_names[e]);
+    fprintf(stderr, "\n");
+
+    uint64_t total[STAT_COUNT] = { 0 };
+    uint64_t total_perf[PERF_COUNT] = { 0 };
+    bool total_measured[PERF_COUNT] = { false };
+    // The list is newest first, print in the order the threads started
+    for (int t = 0; t < thread_count; ++t) {
+        for (SolverStats* stats = all_stats; stats != NULL; stats = stats->next) {
+            if (stats->thread != t)
+                continue;
+            bool measured[PERF_COUNT];
+            for (int e = 0; e < PERF_COUNT; ++e)
+                measured[e] = stats->perf_fds[e] >= 0;
+            char label[16];
+            snprintf(label, sizeof(label), "%d", t);
+            print_row(label, stats->count, stats->perf, measured, with_perf);
+            for (int s = 0; s < STAT_COUNT; ++s)
+                total[s] += stats->count[s];
+            for (int e = 0; e < PERF_COUNT; ++e) {
+                total_perf[e] += stats->perf[e];
+                total_measured[e] |= measured[e];
+            }
+        }
+    }
+    print_row("total", total, total_perf, total_measured, with_perf);
+}
+
+#endif
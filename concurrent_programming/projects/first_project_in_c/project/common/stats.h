@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+// Counters of the hot paths of the solvers, compiled in with `cmake -DSOLVER_STATS=ON` (see CMakeLists.txt).
+// Without it STAT_ADD() and the functions below compile to nothing.
+//
+// Each thread counts in its own cache line. With SOLVER_STATS set in the environment, stats_print() prints
+// the counters of every thread to stderr. With SOLVER_STATS=perf, each thread also counts hardware events
+// with perf_event_open() (if the kernel allows it, see /proc/sys/kernel/perf_event_paranoid).
+
+typedef enum Stat {
+    STAT_SUMSET_ADD, // Sumsets built (sumset_add() and each sibling of sumset_add_siblings())
+    STAT_TRIVIAL, // Children with s(a + x) ∩ s(b) = {0}, searched further
+    STAT_NONTRIVIAL, // Other children, where the search stops
+    STAT_SOLUTION, // Leaves with s(a) ∩ s(b) = {0, ∑b}
+    STAT_IMPROVEMENT, // Solutions better than the best one known by the thread
+    STAT_TASK, // Tasks taken by the thread (parallel)
+    STAT_STEAL, // Parts of frames received from other threads (parallel)
+    STAT_COUNT
+} Stat;
+
+#ifdef SOLVER_STATS
+
+#include <stdalign.h>
+
+typedef enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_COUNT
+} PerfEvent;
+
+typedef struct SolverStats {
+    alignas(64) uint64_t count[STAT_COUNT];
+    uint64_t perf[PERF_COUNT];
+    int perf_fds[PERF_COUNT]; // -1 if not measured
+    int thread; // Number of the thread, in the order of stats_thread_start()
+    struct SolverStats* next;
+} SolverStats;
+
+// The counters of the current thread (a shared scratch slot before stats_thread_start()).
+extern _Thread_local SolverStats* _solver_stats;
+
+#define STAT_ADD(stat, n) (_solver_stats->count[(stat)] += (n))
+
+// Give the current thread its own counters, and start its hardware counters with SOLVER_STATS=perf.
+void stats_thread_start(void);
+
+// Stop the hardware counters of the current thread.
+void stats_thread_stop(void);
+
+// With SOLVER_STATS set in the environment, print the counters of all threads and their sums to stderr.
+void stats_print(void);
+
+#else
+
+#define STAT_ADD(stat, n) ((void)0)
+
+static inline void stats_thread_start(void) {}
+
+static inline void stats_thread_stop(void) {}
+
+static inline void stats_print(void) {}
+
+#endif
@@ -5,6 +5,8 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include "common/stats.h"
+#include "common/trace.h"
 
 #ifdef LOG_SUMSET
 #include <stdio.h>
@@ -22,6 +24,97 @@ typedef uint64_t Word;
 #define BITS_PER_WORD (sizeof(Word) * 8)
 #define MAX_WORDS ((MAX_BITS + BITS_PER_WORD - 1) / BITS_PER_WORD)
 
+// Number of words the functions below work on. A translation unit can define it below MAX_WORDS
+// (before including this file) if all its sums stay below SUMSET_WORDS * BITS_PER_WORD.
+// The loops then have a constant bound, and the kernels below are not called at all for less than
+// SUMSET_KERNEL_MIN_WORDS words (see nonrecursive/CMakeLists.txt for the specializations per d).
+// The struct always has MAX_WORDS words, so sumsets can be passed between translation units.
+#ifndef SUMSET_WORDS
+#define SUMSET_WORDS MAX_WORDS
+#endif
+#define SUMSET_BITS (SUMSET_WORDS * (int)BITS_PER_WORD)
+
+// With SUMSET_BOUNDED defined, the functions below only touch the words up to sum / BITS_PER_WORD
+// (all bits above sum are zero). The words above it are then left uninitialized by sumset_add.
+// Both modes represent the same sumsets, the choice is made per executable (see nonrecursive/CMakeLists.txt).
+
+// Loops over ranges of words used by the functions below, selected at startup for the CPU
+// (AVX-512, AVX2 or plain 64-bit code, see sumset_kernels.c).
+typedef struct SumsetKernels {
+    const char* name;
+    // Sets result[i] = a[i] | (a[i - s] << r) | (a[i - s - 1] >> (BITS_PER_WORD - r)), for i from last down to first
+    // (so result can be a).
+    void (*shift_or)(Word* result, const Word* a, int first, int last, int s, int r);
+    // Returns the number of bits set in a[i] & b[i] for i < words.
+    size_t (*and_popcount)(const Word* a, const Word* b, int words);
+    // Returns whether a[i] & b[i] != 0 for some i < words.
+    bool (*and_any)(const Word* a, const Word* b, int words);
+    // Returns whether ((a[i - s] << r) | (a[i - s - 1] >> (BITS_PER_WORD - r))) & b[i] != 0 for some first <= i <= last.
+    bool (*shifted_and_any)(const Word* a, const Word* b, int first, int last, int s, int r);
+    // Sets results[k][i] = a[i] | (a[i] << r[k]) | (a[i - 1] >> (BITS_PER_WORD - r[k])), for i < words and k < n
+    // (a[-1] is read as 0). Each word of a is loaded once for all n results.
+    void (*add_siblings)(Word* const* results, const Word* a, int words, const int* r, int n);
+} SumsetKernels;
+
+extern SumsetKernels _sumset_kernels;
+
+// Shorter ranges are handled inline, the call would cost more than the vector instructions save.
+#define SUMSET_KERNEL_MIN_WORDS 4
+
+static inline void _sumset_shift_or(Word* result, const Word* a, int first, int last, int s, int r)
+{
+    if (SUMSET_WORDS >= SUMSET_KERNEL_MIN_WORDS && last - first + 1 >= SUMSET_KERNEL_MIN_WORDS) {
+        _sumset_kernels.shift_or(result, a, first, last, s, r);
+        return;
+    }
+    for (int i = last; i >= first; --i)
+        result[i] = a[i] | (a[i - s] << r) | (a[i - s - 1] >> (BITS_PER_WORD - r));
+}
+
+static inline size_t _sumset_and_popcount(const Word* a, const Word* b, int words)
+{
+    if (SUMSET_WORDS >= SUMSET_KERNEL_MIN_WORDS && words >= SUMSET_KERNEL_MIN_WORDS)
+        return _sumset_kernels.and_popcount(a, b, words);
+    size_t c = 0;
+    for (int i = 0; i < words; ++i)
+        c += __builtin_popcountll(a[i] & b[i]);
+    return c;
+}
+
+static inline bool _sumset_and_any(const Word* a, const Word* b, int words)
+{
+    if (SUMSET_WORDS >= SUMSET_KERNEL_MIN_WORDS && words >= SUMSET_KERNEL_MIN_WORDS)
+        return _sumset_kernels.and_any(a, b, words);
+    for (int i = 0; i < words; ++i)
+        if (a[i] & b[i])
+            return true;
+    return false;
+}
+
+static inline bool _sumset_shifted_and_any(const Word* a, const Word* b, int first, int last, int s, int r)
+{
+    if (SUMSET_WORDS >= SUMSET_KERNEL_MIN_WORDS && last - first + 1 >= SUMSET_KERNEL_MIN_WORDS)
+        return _sumset_kernels.shifted_and_any(a, b, first, last, s, r);
+    for (int i = first; i <= last; ++i)
+        if (((a[i - s] << r) | (a[i - s - 1] >> (BITS_PER_WORD - r))) & b[i])
+            return true;
+    return false;
+}
+
+static inline void _sumset_add_siblings(Word* const* results, const Word* a, int words, const int* r, int n)
+{
+    if (SUMSET_WORDS >= SUMSET_KERNEL_MIN_WORDS && words >= SUMSET_KERNEL_MIN_WORDS) {
+        _sumset_kernels.add_siblings(results, a, words, r, n);
+        return;
+    }
+    // Few words, they stay in registers for all the siblings
+    for (int k = 0; k < n; ++k) {
+        results[k][0] = a[0] | (a[0] << r[k]);
+        for (int i = 1; i < words; ++i)
+            results[k][i] = a[i] | (a[i] << r[k]) | (a[i - 1] >> (BITS_PER_WORD - r[k]));
+    }
+}
+
 // Represents the sumset A^Σ of a multiset A, with some info about A.
 typedef struct Sumset {
     // Element last added to the multiset A (1 if nothing has been added).
@@ -51,13 +144,50 @@ static inline void sumset_init(Sumset* s)
 // Return whether the sumset A^Σ contains the value x (that is, x is a sum of some subset of A).
 static inline bool does_sumset_contain(const Sumset* a, int x)
 {
-    if (x >= MAX_BITS)
+#ifdef SUMSET_BOUNDED
+    if (x > a->sum)
         return false;
+#else
+    if (x >= MAX_BITS || x >= SUMSET_BITS)
+        return false;
+#endif
     return a->sumset[x / BITS_PER_WORD] & (((Word)1) << (x % BITS_PER_WORD));
 }
 
 static inline void _sumset_add(Sumset* result, const Sumset* a, int x);
 
+static inline void _sumset_log_add(const Sumset* a, int x)
+{
+    STAT_ADD(STAT_SUMSET_ADD, 1);
+#ifdef TRACE_SUMSET
+    trace_sumset_add(a->sum, x, a->sumset);
+#endif
+#ifdef LOG_SUMSET
+    pthread_mutex_lock(&_stdout_mutex);
+    printf("sumset_add: %d %d; ", x, a->sum);
+    for (int i = 0; i <= MAX_BITS; ++i)
+        if (does_sumset_contain(a, i))
+            printf(" %d", i);
+    printf("\n");
+    pthread_mutex_unlock(&_stdout_mutex);
+#else
+    (void)a;
+    (void)x;
+#endif
+}
+
+// Return the i-th word of words, reading the words above top as 0.
+static inline Word _sumset_word_up_to(const Word* words, int top, int i)
+{
+    return (i <= top) ? words[i] : 0;
+}
+
+// Return the i-th word of the sumset, reading words above sum / BITS_PER_WORD as 0.
+static inline Word _sumset_word(const Sumset* a, int i)
+{
+    return _sumset_word_up_to(a->sumset, a->sum / BITS_PER_WORD, i);
+}
+
 // Set `*result` to represent (A ∪ {x})^Σ, where `a` represents A^Σ, and `x` is an element added to A.
 //
 // Also sets result->last=x and result->prev=a (keeping track of added elements, for recovery in with solution_build()).
@@ -78,18 +208,12 @@ static inline void sumset_add(Sumset* result, const Sumset* a, int x)
 // Same as `sumset_add`, but leaves `result->prev` and `result->last` unchanged (they must already be initialized).
 // (This is only useful for setting up the initial forced multisets A_0, B_0 in input_data_init/input_data_read).
 static inline void _sumset_add(Sumset* result, const Sumset* a, int x) {
-    result->sum = a->sum + x;
-    assert(result->sum < MAX_BITS);
+    // Read before result is written, result can be a
+    int a_sum = a->sum;
+    result->sum = a_sum + x;
+    assert(result->sum < MAX_BITS && result->sum < SUMSET_BITS);
 
-#ifdef LOG_SUMSET
-    pthread_mutex_lock(&_stdout_mutex);
-    printf("sumset_add: %d %d; ", x, a->sum);
-    for (int i = 0; i <= MAX_BITS; ++i)
-        if (does_sumset_contain(a, i))
-            printf(" %d", i);
-    printf("\n");
-    pthread_mutex_unlock(&_stdout_mutex);
-#endif
+    _sumset_log_add(a, x);
 
     // The following does:
     //   result->sumset =  a->sumset | (a->sumset << x);
@@ -98,23 +222,82 @@ static inline void _sumset_add(Sumset* result, const Sumset* a, int x) {
     int s = x / BITS_PER_WORD;
     int r = x % BITS_PER_WORD;
 
-    for (int i = MAX_WORDS - 1; i > s; --i)
-        result->sumset[i] = a->sumset[i] | (a->sumset[i - s] << r) | (a->sumset[i - s - 1] >> (BITS_PER_WORD - r));
+#ifdef SUMSET_BOUNDED
+    int i = result->sum / BITS_PER_WORD;
+    int a_top = a_sum / BITS_PER_WORD;
+    // At most s + 1 words above a_top, where the words of a are not initialized.
+    for (; i > s && i > a_top; --i)
+        result->sumset[i] = (_sumset_word_up_to(a->sumset, a_top, i - s) << r)
+                            | (_sumset_word_up_to(a->sumset, a_top, i - s - 1) >> (BITS_PER_WORD - r));
+    _sumset_shift_or(result->sumset, a->sumset, s + 1, i, s, r);
+    result->sumset[s] = _sumset_word_up_to(a->sumset, a_top, s) | a->sumset[0] << r;
+    for (i = s - 1; i >= 0; --i)
+        result->sumset[i] = _sumset_word_up_to(a->sumset, a_top, i);
+#else
+    _sumset_shift_or(result->sumset, a->sumset, s + 1, SUMSET_WORDS - 1, s, r);
     result->sumset[s] = a->sumset[s] | a->sumset[0] << r;
     for (int i = s - 1; i >= 0; --i)
         result->sumset[i] = a->sumset[i];
+#endif
 }
 
+// Largest number of sumsets built by one sumset_add_siblings() call.
+#define SUMSET_SIBLINGS 8
+
+// Same as sumset_add(results[k], a, xs[k]) for each k < n (at most SUMSET_SIBLINGS), in one pass over the words of `a`.
+// The results must be distinct from `a`.
+static inline void sumset_add_siblings(Sumset* const results[], const Sumset* a, const int xs[], int n)
+{
+    static_assert(MAX_D < BITS_PER_WORD, "Each added element must only shift within a word");
+    assert(n <= SUMSET_SIBLINGS);
+    if (n == 0)
+        return;
+
+    Word* words_of[SUMSET_SIBLINGS];
+    for (int k = 0; k < n; ++k) {
+        assert(xs[k] >= a->last);
+        assert(xs[k] <= MAX_D);
+        results[k]->prev = a;
+        results[k]->last = xs[k];
+        results[k]->sum = a->sum + xs[k];
+        assert(results[k]->sum < MAX_BITS && results[k]->sum < SUMSET_BITS);
+        _sumset_log_add(a, xs[k]);
+        words_of[k] = results[k]->sumset;
+    }
+
+#ifdef SUMSET_BOUNDED
+    int words = a->sum / BITS_PER_WORD + 1;
+    _sumset_add_siblings(words_of, a->sumset, words, xs, n);
+    // The word right above the sum of a only gets the shifted bits, and only the siblings reaching it have it
+    // (sumsets in a SumsetArena end at their sum).
+    for (int k = 0; k < n; ++k)
+        if (results[k]->sum / (int)BITS_PER_WORD == words)
+            words_of[k][words] = a->sumset[words - 1] >> (BITS_PER_WORD - xs[k]);
+#else
+    _sumset_add_siblings(words_of, a->sumset, SUMSET_WORDS, xs, n);
+#endif
+}
+
+#ifdef SUMSET_BOUNDED
+// Number of words that can have bits common to A^Σ and B^Σ (none above min(ΣA, ΣB)).
+static inline int _sumset_common_words(const Sumset* a, const Sumset* b)
+{
+    int words = ((a->sum < b->sum) ? a->sum : b->sum) / BITS_PER_WORD + 1;
+    // Always true, but it bounds the loops for the compiler
+    return (words < SUMSET_WORDS) ? words : SUMSET_WORDS;
+}
+#define _SUMSET_WORDS(a, b) _sumset_common_words(a, b)
+#else
+#define _SUMSET_WORDS(a, b) SUMSET_WORDS
+#endif
+
 
 // Return |{A^Σ} ∩ {B^Σ}|, the number of distinct values in the intersection of the sumsets A^Σ and B^Σ.
 // Note that if this returns 1, then the intersection is {0}.
 // If ΣA=ΣB and this returns 2, then the intersection is {0, ΣA}.
 static inline size_t get_sumset_intersection_size(const Sumset* a, const Sumset* b)
 {
-    size_t c = 0;
-    for (int i = 0; i < MAX_WORDS; ++i)
-        c += __builtin_popcountll(a->sumset[i] & b->sumset[i]);
-    return c;
+    return _sumset_and_popcount(a->sumset, b->sumset, _SUMSET_WORDS(a, b));
 }
 
 // Return whether the intersection of the sumsets A^Σ and B^Σ is trivial (contains only 0).
@@ -123,8 +306,99 @@ static inline bool is_sumset_intersection_trivial(const Sumset* a, const Sumset*
 {
     if ((a->sumset[0] & b->sumset[0]) != 1)
         return false;
-    for (int i = 1; i < MAX_WORDS; ++i)
-        if (a->sumset[i] & b->sumset[i])
+    return !_sumset_and_any(a->sumset + 1, b->sumset + 1, _SUMSET_WORDS(a, b) - 1);
+}
+
+// Sumsets are palindromes: x is in A^Σ iff ΣA - x is. So if ΣA = ΣB, a common value x
+// has the common mirror image ΣA - x, and only the values up to ΣA / 2 need to be compared.
+
+// Return a mask of the bits up to x % BITS_PER_WORD, in the word x / BITS_PER_WORD.
+static inline Word _sumset_mask_up_to(int x)
+{
+    return ~(Word)0 >> (BITS_PER_WORD - 1 - x % BITS_PER_WORD);
+}
+
+// Return whether A^Σ ∩ B^Σ = {0, ΣA}, for ΣA = ΣB (a solution).
+// This is equivalent to get_sumset_intersection_size(a, b) == 2, but only compares the values up to ΣA / 2.
+static inline bool is_sumset_intersection_solution(const Sumset* a, const Sumset* b)
+{
+    assert(a->sum == b->sum);
+    if (a->sum == 0)
+        return false;
+    int half = a->sum / 2;
+    int top = half / BITS_PER_WORD;
+    Word first = a->sumset[0] & b->sumset[0] & ~(Word)1;
+    if (top == 0)
+        return !(first & _sumset_mask_up_to(half));
+    if (first || (a->sumset[top] & b->sumset[top] & _sumset_mask_up_to(half)))
+        return false;
+    return !_sumset_and_any(a->sumset + 1, b->sumset + 1, top - 1);
+}
+
+// Return a mask with the bit x set for each from <= x <= to such that x is not in B^Σ (to must be below BITS_PER_WORD).
+// These are the elements that can be added to A next: the children of a node, if from is A's last.
+static inline Word sumset_missing_mask(const Sumset* b, int from, int to)
+{
+    static_assert(MAX_D < BITS_PER_WORD, "The elements must fit in the first word");
+    Word range = (((Word)2 << to) - 1) & ~(((Word)1 << from) - 1);
+    return ~b->sumset[0] & range;
+}
+
+// Return the word i of (A^Σ + x), the sumset A^Σ shifted by x (s = x / BITS_PER_WORD, r = x % BITS_PER_WORD).
+static inline Word _sumset_shifted_word(const Sumset* a, int i, int s, int r)
+{
+    if (i == s)
+        return a->sumset[0] << r;
+    return (_sumset_word(a, i - s) << r) | (_sumset_word(a, i - s - 1) >> (BITS_PER_WORD - r));
+}
+
+// Return whether (A^Σ + x) ∩ B^Σ = ∅, without building (A ∪ {x})^Σ.
+// If A^Σ ∩ B^Σ = {0}, this is whether the intersection stays {0} after sumset_add(result, a, x),
+// that is is_sumset_intersection_trivial(result, b).
+static inline bool is_shifted_intersection_empty(const Sumset* a, const Sumset* b, int x)
+{
+    int s = x / BITS_PER_WORD;
+    int r = x % BITS_PER_WORD;
+    // No common values above the smaller sum.
+    int top = ((a->sum + x < b->sum) ? a->sum + x : b->sum) / BITS_PER_WORD;
+    if (top < s)
+        return true;
+    if (_sumset_shifted_word(a, s, s, r) & b->sumset[s])
+        return false;
+    if (top == s)
+        return true;
+    // The top word can be the one reading the word of a right above its sum.
+    if (_sumset_shifted_word(a, top, s, r) & b->sumset[top])
+        return false;
+    return !_sumset_shifted_and_any(a->sumset, b->sumset, s + 1, top - 1, s, r);
+}
+
+// Return |(A^Σ + x) ∩ B^Σ|, without building (A ∪ {x})^Σ.
+// If A^Σ ∩ B^Σ = {0} and ΣA + x = ΣB, this is 1 iff get_sumset_intersection_size(result, b) == 2
+// after sumset_add(result, a, x), which makes it a solution.
+static inline size_t get_shifted_intersection_size(const Sumset* a, const Sumset* b, int x)
+{
+    int s = x / BITS_PER_WORD;
+    int r = x % BITS_PER_WORD;
+    int top = ((a->sum + x < b->sum) ? a->sum + x : b->sum) / BITS_PER_WORD;
+    size_t c = 0;
+    for (int i = s; i <= top; ++i)
+        c += __builtin_popcountll(_sumset_shifted_word(a, i, s, r) & b->sumset[i]);
+    return c;
+}
+
+// Return whether (A ∪ {x})^Σ ∩ B^Σ = {0, ΣB}, knowing that A^Σ ∩ B^Σ = {0} and ΣA + x = ΣB (a solution),
+// without building (A ∪ {x})^Σ. Equivalent to get_shifted_intersection_size(a, b, x) == 1,
+// but by symmetry only (A^Σ + x) up to ΣB / 2 needs to be disjoint from B^Σ.
+static inline bool is_shifted_intersection_solution(const Sumset* a, const Sumset* b, int x)
+{
+    assert(a->sum + x == b->sum);
+    int s = x / BITS_PER_WORD;
+    int r = x % BITS_PER_WORD;
+    int half = b->sum / 2;
+    int top = half / BITS_PER_WORD;
+    for (int i = s; i < top; ++i)
+        if (_sumset_shifted_word(a, i, s, r) & b->sumset[i])
             return false;
-    return true;
-}
\ No newline at end of file
+    return !(_sumset_shifted_word(a, top, s, r) & b->sumset[top] & _sumset_mask_up_to(half));
+}
@@ -0,0 +1,40 @@
+#include "common/sumset_arena.h"
+#include "common/err.h"
+
+#include <stdlib.h>
+
+static SumsetArenaBlock* block_new(size_t capacity)
+{
+    SumsetArenaBlock* block = malloc(sizeof(SumsetArenaBlock) + capacity);
+    if (block == NULL)
+        fatal("Cannot allocate %zu bytes for sumsets", capacity);
+    block->next = NULL;
+    block->capacity = capacity;
+    return block;
+}
+
+void sumset_arena_init(SumsetArena* arena, size_t block_bytes)
+{
+    assert(block_bytes >= sizeof(Sumset));
+    arena->first = arena->block = block_new(block_bytes);
+    arena->used = 0;
+}
+
+void sumset_arena_free(SumsetArena* arena)
+{
+    SumsetArenaBlock* block = arena->first;
+    while (block != NULL) {
+        SumsetArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->first = arena->block = NULL;
+}
+
+void _sumset_arena_next_block(SumsetArena* arena)
+{
+    if (arena->block->next == NULL)
+        arena->block->next = block_new(arena->first->capacity);
+    arena->block = arena->block->next;
+    arena->used = 0;
+}
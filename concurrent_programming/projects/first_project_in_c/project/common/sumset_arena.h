@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdalign.h>
+#include <stddef.h>
+#include <string.h>
+#include "common/sumset.h"
+
+// Storage for sumsets built with SUMSET_BOUNDED, where each one only takes the words up to its sum.
+//
+// Sumsets are allocated and released in stack order (sumset_arena_mark() and sumset_arena_release()).
+// The memory comes in blocks, which are kept after a release and reused, so the arena only takes as much
+// as the deepest point of the search needs. Sumsets in an arena must not be copied as a whole struct
+// (use sumset_arena_copy()), and only functions reading the words up to the sum can be used on them.
+
+typedef struct SumsetArenaBlock {
+    struct SumsetArenaBlock* next; // The block used after this one is full, NULL if not allocated yet
+    size_t capacity; // In bytes
+    alignas(Word) char data[];
+} SumsetArenaBlock;
+
+typedef struct SumsetArena {
+    SumsetArenaBlock* first;
+    SumsetArenaBlock* block; // The block allocations currently come from
+    size_t used; // Bytes used in block
+} SumsetArena;
+
+// A point in the arena to return to.
+typedef struct SumsetArenaMark {
+    SumsetArenaBlock* block;
+    size_t used;
+} SumsetArenaMark;
+
+// Size of the blocks of the arenas of the solvers, enough for the whole path of most searches
+#define SUMSET_ARENA_BLOCK_BYTES (64 << 10)
+
+// Initialize an arena with one block of block_bytes, at least sizeof(Sumset) (later blocks are as big).
+void sumset_arena_init(SumsetArena* arena, size_t block_bytes);
+
+void sumset_arena_free(SumsetArena* arena);
+
+// Move to the next block, allocating it if needed.
+void _sumset_arena_next_block(SumsetArena* arena);
+
+// Number of bytes of a sumset with the given sum, up to its last word.
+static inline size_t sumset_bytes(int sum)
+{
+    return offsetof(Sumset, sumset) + (sum / BITS_PER_WORD + 1) * sizeof(Word);
+}
+
+// Return uninitialized room for a sumset with the given sum (for sumset_add() and sumset_add_siblings()).
+static inline Sumset* sumset_arena_alloc(SumsetArena* arena, int sum)
+{
+    size_t bytes = sumset_bytes(sum);
+    if (arena->used + bytes > arena->block->capacity)
+        _sumset_arena_next_block(arena);
+    Sumset* s = (Sumset*)(arena->block->data + arena->used);
+    arena->used += bytes;
+    return s;
+}
+
+// Return a copy of s (including its last and prev).
+static inline Sumset* sumset_arena_copy(SumsetArena* arena, const Sumset* s)
+{
+    Sumset* copy = sumset_arena_alloc(arena, s->sum);
+    memcpy(copy, s, sumset_bytes(s->sum));
+    return copy;
+}
+
+static inline SumsetArenaMark sumset_arena_mark(const SumsetArena* arena)
+{
+    return (SumsetArenaMark){ arena->block, arena->used };
+}
+
+// Release all sumsets allocated since mark was taken.
+static inline void sumset_arena_release(SumsetArena* arena, SumsetArenaMark mark)
+{
+    arena->block = mark.block;
+    arena->used = mark.used;
+}
+
+// Release all sumsets.
+static inline void sumset_arena_clear(SumsetArena* arena)
+{
+    arena->block = arena->first;
+    arena->used = 0;
+}
@@ -0,0 +1,263 @@
+#include "common/sumset.h"
+#include "common/err.h"
+
+#include <immintrin.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void shift_or_scalar(Word* result, const Word* a, int first, int last, int s, int r)
+{
+    for (int i = last; i >= first; --i)
+        result[i] = a[i] | (a[i - s] << r) | (a[i - s - 1] >> (BITS_PER_WORD - r));
+}
+
+static size_t and_popcount_scalar(const Word* a, const Word* b, int words)
+{
+    size_t c = 0;
+    for (int i = 0; i < words; ++i)
+        c += __builtin_popcountll(a[i] & b[i]);
+    return c;
+}
+
+static bool and_any_scalar(const Word* a, const Word* b, int words)
+{
+    for (int i = 0; i < words; ++i)
+        if (a[i] & b[i])
+            return true;
+    return false;
+}
+
+static bool shifted_and_any_scalar(const Word* a, const Word* b, int first, int last, int s, int r)
+{
+    for (int i = first; i <= last; ++i)
+        if (((a[i - s] << r) | (a[i - s - 1] >> (BITS_PER_WORD - r))) & b[i])
+            return true;
+    return false;
+}
+
+static void add_siblings_scalar(Word* const* results, const Word* a, int words, const int* r, int n)
+{
+    Word prev = 0;
+    for (int i = 0; i < words; ++i) {
+        for (int k = 0; k < n; ++k)
+            results[k][i] = a[i] | (a[i] << r[k]) | (prev >> (BITS_PER_WORD - r[k]));
+        prev = a[i];
+    }
+}
+
+// AVX2: 4 words per instruction, VPTEST for the intersection test.
+// There is no vector popcount, so the count uses POPCNT on single words.
+
+__attribute__((target("avx2")))
+static void shift_or_avx2(Word* result, const Word* a, int first, int last, int s, int r)
+{
+    __m128i left = _mm_cvtsi32_si128(r);
+    __m128i right = _mm_cvtsi32_si128(BITS_PER_WORD - r);
+    int i = last;
+    // Going down, the words read by the next block are not written yet.
+    for (; i - 3 >= first; i -= 4) {
+        __m256i same = _mm256_loadu_si256((const __m256i*)&a[i - 3]);
+        __m256i high = _mm256_loadu_si256((const __m256i*)&a[i - 3 - s]);
+        __m256i low = _mm256_loadu_si256((const __m256i*)&a[i - 4 - s]);
+        __m256i shifted = _mm256_or_si256(_mm256_sll_epi64(high, left), _mm256_srl_epi64(low, right));
+        _mm256_storeu_si256((__m256i*)&result[i - 3], _mm256_or_si256(same, shifted));
+    }
+    shift_or_scalar(result, a, first, i, s, r);
+}
+
+__attribute__((target("popcnt")))
+static size_t and_popcount_popcnt(const Word* a, const Word* b, int words)
+{
+    size_t c = 0;
+    for (int i = 0; i < words; ++i)
+        c += __builtin_popcountll(a[i] & b[i]);
+    return c;
+}
+
+__attribute__((target("avx2")))
+static bool and_any_avx2(const Word* a, const Word* b, int words)
+{
+    int i = 0;
+    for (; i + 4 <= words; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)&a[i]);
+        __m256i y = _mm256_loadu_si256((const __m256i*)&b[i]);
+        if (!_mm256_testz_si256(x, y))
+            return true;
+    }
+    return and_any_scalar(a + i, b + i, words - i);
+}
+
+__attribute__((target("avx2")))
+static bool shifted_and_any_avx2(const Word* a, const Word* b, int first, int last, int s, int r)
+{
+    __m128i left = _mm_cvtsi32_si128(r);
+    __m128i right = _mm_cvtsi32_si128(BITS_PER_WORD - r);
+    int i = first;
+    for (; i + 3 <= last; i += 4) {
+        __m256i high = _mm256_loadu_si256((const __m256i*)&a[i - s]);
+        __m256i low = _mm256_loadu_si256((const __m256i*)&a[i - s - 1]);
+        __m256i shifted = _mm256_or_si256(_mm256_sll_epi64(high, left), _mm256_srl_epi64(low, right));
+        if (!_mm256_testz_si256(shifted, _mm256_loadu_si256((const __m256i*)&b[i])))
+            return true;
+    }
+    return shifted_and_any_scalar(a, b, i, last, s, r);
+}
+
+// The parent words are loaded once per block of 4 and kept in registers while the block of every sibling is written.
+__attribute__((target("avx2")))
+static void add_siblings_avx2(Word* const* results, const Word* a, int words, const int* r, int n)
+{
+    __m128i left[SUMSET_SIBLINGS], right[SUMSET_SIBLINGS];
+    for (int k = 0; k < n; ++k) {
+        left[k] = _mm_cvtsi32_si128(r[k]);
+        right[k] = _mm_cvtsi32_si128(BITS_PER_WORD - r[k]);
+    }
+
+    __m256i previous = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 4 <= words; i += 4) {
+        __m256i same = _mm256_loadu_si256((const __m256i*)&a[i]);
+        // a[i - 1 .. i + 2], with a[i - 1] taken from the previous block
+        __m256i low = _mm256_blend_epi32(_mm256_permute4x64_epi64(same, 0x93),
+                                         _mm256_permute4x64_epi64(previous, 0xff), 0x03);
+        for (int k = 0; k < n; ++k) {
+            __m256i shifted = _mm256_or_si256(_mm256_sll_epi64(same, left[k]), _mm256_srl_epi64(low, right[k]));
+            _mm256_storeu_si256((__m256i*)&results[k][i], _mm256_or_si256(same, shifted));
+        }
+        previous = same;
+    }
+    for (; i < words; ++i)
+        for (int k = 0; k < n; ++k)
+            results[k][i] = a[i] | (a[i] << r[k]) | ((i > 0 ? a[i - 1] : 0) >> (BITS_PER_WORD - r[k]));
+}
+
+// AVX-512: 8 words per instruction, masked loads for the rest, VPOPCNTQ and VPTESTMQ.
+
+__attribute__((target("avx512f")))
+static void shift_or_avx512(Word* result, const Word* a, int first, int last, int s, int r)
+{
+    __m128i left = _mm_cvtsi32_si128(r);
+    __m128i right = _mm_cvtsi32_si128(BITS_PER_WORD - r);
+    int i = last;
+    // Going down, the words read by the next block are not written yet.
+    for (; i - 7 >= first; i -= 8) {
+        __m512i same = _mm512_loadu_si512(&a[i - 7]);
+        __m512i high = _mm512_loadu_si512(&a[i - 7 - s]);
+        __m512i low = _mm512_loadu_si512(&a[i - 8 - s]);
+        __m512i shifted = _mm512_or_si512(_mm512_sll_epi64(high, left), _mm512_srl_epi64(low, right));
+        _mm512_storeu_si512(&result[i - 7], _mm512_or_si512(same, shifted));
+    }
+    if (i >= first) {
+        int n = i - first + 1;
+        __mmask8 mask = (1u << n) - 1;
+        __m512i same = _mm512_maskz_loadu_epi64(mask, &a[first]);
+        __m512i high = _mm512_maskz_loadu_epi64(mask, &a[first - s]);
+        __m512i low = _mm512_maskz_loadu_epi64(mask, &a[first - s - 1]);
+        __m512i shifted = _mm512_or_si512(_mm512_sll_epi64(high, left), _mm512_srl_epi64(low, right));
+        _mm512_mask_storeu_epi64(&result[first], mask, _mm512_or_si512(same, shifted));
+    }
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static size_t and_popcount_avx512(const Word* a, const Word* b, int words)
+{
+    __m512i count = _mm512_setzero_si512();
+    for (int i = 0; i < words; i += 8) {
+        __mmask8 mask = (words - i >= 8) ? 0xff : (1u << (words - i)) - 1;
+        __m512i x = _mm512_maskz_loadu_epi64(mask, &a[i]);
+        __m512i y = _mm512_maskz_loadu_epi64(mask, &b[i]);
+        count = _mm512_add_epi64(count, _mm512_popcnt_epi64(_mm512_and_si512(x, y)));
+    }
+    return _mm512_reduce_add_epi64(count);
+}
+
+__attribute__((target("avx512f")))
+static bool and_any_avx512(const Word* a, const Word* b, int words)
+{
+    for (int i = 0; i < words; i += 8) {
+        __mmask8 mask = (words - i >= 8) ? 0xff : (1u << (words - i)) - 1;
+        __m512i x = _mm512_maskz_loadu_epi64(mask, &a[i]);
+        __m512i y = _mm512_maskz_loadu_epi64(mask, &b[i]);
+        if (_mm512_test_epi64_mask(x, y))
+            return true;
+    }
+    return false;
+}
+
+__attribute__((target("avx512f")))
+static bool shifted_and_any_avx512(const Word* a, const Word* b, int first, int last, int s, int r)
+{
+    __m128i left = _mm_cvtsi32_si128(r);
+    __m128i right = _mm_cvtsi32_si128(BITS_PER_WORD - r);
+    for (int i = first; i <= last; i += 8) {
+        __mmask8 mask = (last - i + 1 >= 8) ? 0xff : (1u << (last - i + 1)) - 1;
+        __m512i high = _mm512_maskz_loadu_epi64(mask, &a[i - s]);
+        __m512i low = _mm512_maskz_loadu_epi64(mask, &a[i - s - 1]);
+        __m512i shifted = _mm512_or_si512(_mm512_sll_epi64(high, left), _mm512_srl_epi64(low, right));
+        if (_mm512_test_epi64_mask(shifted, _mm512_maskz_loadu_epi64(mask, &b[i])))
+            return true;
+    }
+    return false;
+}
+
+// Same as add_siblings_avx2(), with blocks of 8 words and a masked last block.
+__attribute__((target("avx512f")))
+static void add_siblings_avx512(Word* const* results, const Word* a, int words, const int* r, int n)
+{
+    __m128i left[SUMSET_SIBLINGS], right[SUMSET_SIBLINGS];
+    for (int k = 0; k < n; ++k) {
+        left[k] = _mm_cvtsi32_si128(r[k]);
+        right[k] = _mm_cvtsi32_si128(BITS_PER_WORD - r[k]);
+    }
+
+    __m512i previous = _mm512_setzero_si512();
+    for (int i = 0; i < words; i += 8) {
+        __mmask8 mask = (words - i >= 8) ? 0xff : (1u << (words - i)) - 1;
+        __m512i same = _mm512_maskz_loadu_epi64(mask, &a[i]);
+        // a[i - 1 .. i + 6], with a[i - 1] taken from the previous block
+        __m512i low = _mm512_alignr_epi64(same, previous, 7);
+        for (int k = 0; k < n; ++k) {
+            __m512i v = _mm512_ternarylogic_epi64(same, _mm512_sll_epi64(same, left[k]),
+                                                  _mm512_srl_epi64(low, right[k]), 0xfe);
+            _mm512_mask_storeu_epi64(&results[k][i], mask, v);
+        }
+        previous = same;
+    }
+}
+
+static const SumsetKernels scalar_kernels = {
+    "scalar", shift_or_scalar, and_popcount_scalar, and_any_scalar, shifted_and_any_scalar, add_siblings_scalar
+};
+static const SumsetKernels avx2_kernels = {
+    "avx2", shift_or_avx2, and_popcount_popcnt, and_any_avx2, shifted_and_any_avx2, add_siblings_avx2
+};
+static const SumsetKernels avx512_kernels = {
+    "avx512", shift_or_avx512, and_popcount_avx512, and_any_avx512, shifted_and_any_avx512, add_siblings_avx512
+};
+
+// Scalar until sumset_kernels_select() runs, so sumsets built by other constructors are also correct.
+SumsetKernels _sumset_kernels = {
+    "scalar", shift_or_scalar, and_popcount_scalar, and_any_scalar, shifted_and_any_scalar, add_siblings_scalar
+};
+
+// Pick the widest kernels the CPU supports.
+// SUMSET_KERNELS=scalar|avx2|avx512 in the environment forces a family (e.g. for benchmarks).
+__attribute__((constructor)) static void sumset_kernels_select(void)
+{
+    __builtin_cpu_init();
+    bool avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq");
+    bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+
+    const char* forced = getenv("SUMSET_KERNELS");
+    if (forced == NULL) {
+        _sumset_kernels = avx512 ? avx512_kernels : avx2 ? avx2_kernels : scalar_kernels;
+    } else if (strcmp(forced, "scalar") == 0) {
+        _sumset_kernels = scalar_kernels;
+    } else if (strcmp(forced, "avx2") == 0 && avx2) {
+        _sumset_kernels = avx2_kernels;
+    } else if (strcmp(forced, "avx512") == 0 && avx512) {
+        _sumset_kernels = avx512_kernels;
+    } else {
+        fatal("SUMSET_KERNELS=%s is not supported on this CPU", forced);
+    }
+}
@@ -0,0 +1,165 @@
+#include "common/trace.h"
+
+#ifdef TRACE_SUMSET
+
+#include "common/err.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Bytes in the ring of each thread (a power of two). A thread waits when its ring is full.
+#define RING_BYTES (1 << 20)
+// The writer thread looks for new events this often
+#define WRITER_PERIOD_NS 1000000
+
+// A ring with a single producer (its thread) and a single consumer (the writer thread).
+// The bytes in [tail, head) (modulo RING_BYTES) are whole events not written to the file yet.
+typedef struct Ring {
+    alignas(64) atomic_size_t head;
+    alignas(64) atomic_size_t tail;
+    struct Ring* next;
+    unsigned char data[RING_BYTES];
+} Ring;
+
+enum { UNINITIALIZED, ENABLED, DISABLED };
+static atomic_int state = UNINITIALIZED;
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+static FILE* file;
+static pthread_t writer;
+static atomic_bool stopping;
+
+static Ring* rings = NULL; // All rings, newest first
+static int ring_count = 0;
+static pthread_mutex_t rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local Ring* own_ring = NULL;
+static _Thread_local uint16_t own_thread;
+
+// Write the events available in ring to the file. Returns whether there were any.
+static bool ring_drain(Ring* ring)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (head == tail)
+        return false;
+    size_t from = tail % RING_BYTES, to = head % RING_BYTES;
+    if (from < to) {
+        fwrite(ring->data + from, 1, to - from, file);
+    } else {
+        fwrite(ring->data + from, 1, RING_BYTES - from, file);
+        fwrite(ring->data, 1, to, file);
+    }
+    atomic_store_explicit(&ring->tail, head, memory_order_release);
+    return true;
+}
+
+static bool drain_all(void)
+{
+    ASSERT_ZERO(pthread_mutex_lock(&rings_mutex));
+    Ring* first = rings;
+    ASSERT_ZERO(pthread_mutex_unlock(&rings_mutex));
+    // Rings are only added at the front, the ones from first on stay valid
+    bool any = false;
+    for (Ring* ring = first; ring != NULL; ring = ring->next)
+        any |= ring_drain(ring);
+    return any;
+}
+
+static void* writer_function(void* arg)
+{
+    struct timespec period = { 0, WRITER_PERIOD_NS };
+    while (!atomic_load(&stopping)) {
+        if (!drain_all())
+            nanosleep(&period, NULL);
+    }
+    return NULL;
+}
+
+// At exit, after the solvers' threads have finished: write the rest and close the file.
+static void trace_finish(void)
+{
+    atomic_store(&stopping, true);
+    ASSERT_ZERO(pthread_join(writer, NULL));
+    drain_all();
+    if (fclose(file) != 0)
+        syserr("Cannot write the trace");
+}
+
+static void trace_init(void)
+{
+    const char* path = getenv("SUMSET_TRACE");
+    if (path == NULL) {
+        atomic_store(&state, DISABLED);
+        return;
+    }
+    file = fopen(path, "wb");
+    if (file == NULL)
+        syserr("Cannot open the trace %s", path);
+    atomic_init(&stopping, false);
+    ASSERT_ZERO(pthread_create(&writer, NULL, writer_function, NULL));
+    atexit(trace_finish);
+    atomic_store(&state, ENABLED);
+}
+
+static Ring* ring_create(void)
+{
+    Ring* ring = aligned_alloc(alignof(Ring), sizeof(Ring));
+    if (ring == NULL)
+        fatal("Cannot allocate the trace ring of a thread");
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ASSERT_ZERO(pthread_mutex_lock(&rings_mutex));
+    own_thread = ring_count++;
+    ring->next = rings;
+    rings = ring;
+    ASSERT_ZERO(pthread_mutex_unlock(&rings_mutex));
+    return ring;
+}
+
+// Copy bytes to the ring at position head, wrapping around its end.
+static void ring_copy(Ring* ring, size_t head, const void* bytes, size_t size)
+{
+    size_t at = head % RING_BYTES;
+    size_t first = (size < RING_BYTES - at) ? size : RING_BYTES - at;
+    memcpy(ring->data + at, bytes, first);
+    memcpy(ring->data, (const unsigned char*)bytes + first, size - first);
+}
+
+void trace_sumset_add(int parent_sum, int x, const uint64_t* words)
+{
+    if (atomic_load_explicit(&state, memory_order_relaxed) != ENABLED) {
+        pthread_once(&once, trace_init);
+        if (atomic_load(&state) != ENABLED)
+            return;
+    }
+    if (own_ring == NULL)
+        own_ring = ring_create();
+    Ring* ring = own_ring;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    TraceEvent event = {
+        .timestamp = (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec,
+        .parent_sum = parent_sum,
+        .thread = own_thread,
+        .x = x,
+    };
+    size_t words_bytes = trace_event_words(&event) * sizeof(uint64_t);
+    size_t size = sizeof(event) + words_bytes;
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    while (head + size - atomic_load_explicit(&ring->tail, memory_order_acquire) > RING_BYTES)
+        sched_yield();
+    ring_copy(ring, head, &event, sizeof(event));
+    ring_copy(ring, head + sizeof(event), words, words_bytes);
+    atomic_store_explicit(&ring->head, head + size, memory_order_release);
+}
+
+#endif
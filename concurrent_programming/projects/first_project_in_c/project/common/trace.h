@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+// A binary trace of the sumsets built, compiled in with `cmake -DTRACE_SUMSET=ON` (see CMakeLists.txt).
+// It records the same calls as LOG_SUMSET, without its global mutex and text formatting:
+// each thread appends compact events to its own lock-free ring, and a background thread writes the rings
+// to the file named by SUMSET_TRACE in the environment (nothing is recorded if it's not set).
+// trace_decode prints a trace in the format of LOG_SUMSET (see trace_decode.c).
+//
+// The file is a sequence of events, each one a TraceEvent followed by the words of the parent sumset up to
+// its sum (parent_sum / 64 + 1 words). The events of one thread are in order, those of different threads
+// are interleaved.
+
+typedef struct TraceEvent {
+    uint64_t timestamp; // Nanoseconds of CLOCK_MONOTONIC
+    int32_t parent_sum;
+    uint16_t thread; // Number of the thread, in the order of their first events
+    uint16_t x; // The element added
+} TraceEvent;
+
+// Number of words following an event.
+static inline int trace_event_words(const TraceEvent* event)
+{
+    return event->parent_sum / 64 + 1;
+}
+
+#ifdef TRACE_SUMSET
+// Record that x is added to the sumset with the given sum and words (called by the sumset functions).
+void trace_sumset_add(int parent_sum, int x, const uint64_t* words);
+#endif
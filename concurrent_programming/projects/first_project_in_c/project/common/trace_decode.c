@@ -0,0 +1,37 @@
+// Prints a trace written with TRACE_SUMSET (see trace.h) in the format of LOG_SUMSET, one line per event.
+// Usage: trace_decode PATH [--threads]
+// With --threads, each line starts with the thread and the timestamp of the event.
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "common/err.h"
+#include "common/sumset.h"
+#include "common/trace.h"
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3 || (argc == 3 && strcmp(argv[2], "--threads") != 0))
+        fatal("Usage: %s PATH [--threads]", argv[0]);
+    bool threads = (argc == 3);
+    FILE* in = fopen(argv[1], "rb");
+    if (in == NULL)
+        syserr("Cannot open %s", argv[1]);
+
+    TraceEvent event;
+    Word words[MAX_WORDS];
+    while (fread(&event, sizeof(event), 1, in) == 1) {
+        int count = trace_event_words(&event);
+        if (event.parent_sum < 0 || count > MAX_WORDS || fread(words, sizeof(Word), count, in) != (size_t)count)
+            fatal("%s is truncated or corrupted", argv[1]);
+        if (threads)
+            printf("%u %llu ", event.thread, (unsigned long long)event.timestamp);
+        // As _sumset_log_add() in sumset.h
+        printf("sumset_add: %d %d; ", event.x, event.parent_sum);
+        for (int i = 0; i <= event.parent_sum; ++i)
+            if (words[i / BITS_PER_WORD] >> (i % BITS_PER_WORD) & 1)
+                printf(" %d", i);
+        printf("\n");
+    }
+    fclose(in);
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "common/transposition.h"
+#include "common/err.h"
+
+#include <stdlib.h>
+
+// Low bits of an entry: the depth, as a priority (sums grow with the depth).
+#define PRIORITY_BITS 13
+#define PRIORITY_MASK ((1ULL << PRIORITY_BITS) - 1)
+static_assert(2 * MAX_BITS < PRIORITY_MASK, "The priority must fit in its bits");
+
+void transposition_init(TranspositionTable* table, size_t mib)
+{
+    table->entries = NULL;
+    table->mask = 0;
+    if (mib == 0)
+        return;
+
+    size_t buckets = 1;
+    while (buckets * 2 * 2 * sizeof(uint64_t) <= mib << 20)
+        buckets *= 2;
+    table->entries = calloc(2 * buckets, sizeof(uint64_t));
+    if (table->entries == NULL)
+        fatal("Cannot allocate the transposition table of %zu MiB", mib);
+    table->mask = buckets - 1;
+}
+
+void transposition_free(TranspositionTable* table)
+{
+    free(table->entries);
+    table->entries = NULL;
+}
+
+// Hash the words of the sumset up to its sum (the only ones initialized with SUMSET_BOUNDED) into h1 and h2.
+static void hash_sumset(const Sumset* a, uint64_t* h1, uint64_t* h2)
+{
+    *h1 = (*h1 ^ (uint64_t)a->last << 32 ^ (uint64_t)a->sum) * 0x9e3779b97f4a7c15ULL;
+    *h2 = (*h2 ^ (uint64_t)a->sum << 32 ^ (uint64_t)a->last) * 0xc2b2ae3d27d4eb4fULL;
+    for (int i = 0; i <= a->sum / (int)BITS_PER_WORD; ++i) {
+        *h1 = ((*h1 ^ a->sumset[i]) * 0x9e3779b97f4a7c15ULL);
+        *h1 ^= *h1 >> 29;
+        *h2 = ((*h2 ^ a->sumset[i]) * 0xc2b2ae3d27d4eb4fULL);
+        *h2 ^= *h2 >> 31;
+    }
+}
+
+void state_hash(const Sumset* a, const Sumset* b, uint64_t seed, uint64_t hash[2])
+{
+    hash[0] = seed;
+    hash[1] = seed ^ 0x165667b19e3779f9ULL;
+    hash_sumset(a, &hash[0], &hash[1]);
+    hash_sumset(b, &hash[0], &hash[1]);
+}
+
+bool transposition_visit(TranspositionTable* table, const Sumset* a, const Sumset* b)
+{
+    if (table->entries == NULL)
+        return false;
+
+    uint64_t hash[2];
+    state_hash(a, b, 0, hash);
+    uint64_t h1 = hash[0], h2 = hash[1];
+    uint64_t priority = PRIORITY_MASK - (a->sum + b->sum);
+    // The top bit keeps entries non-zero
+    uint64_t entry = ((h2 | 1ULL << 63) & ~PRIORITY_MASK) | priority;
+
+    _Atomic uint64_t* bucket = &table->entries[2 * ((h1 ^ h1 >> 32) & table->mask)];
+    uint64_t first = atomic_load_explicit(&bucket[0], memory_order_relaxed);
+    if (first == entry || atomic_load_explicit(&bucket[1], memory_order_relaxed) == entry)
+        return true;
+
+    if ((first & PRIORITY_MASK) <= priority) {
+        // The state being replaced moves to the second entry
+        atomic_store_explicit(&bucket[0], entry, memory_order_relaxed);
+        atomic_store_explicit(&bucket[1], first, memory_order_relaxed);
+    } else {
+        atomic_store_explicit(&bucket[1], entry, memory_order_relaxed);
+    }
+    return false;
+}
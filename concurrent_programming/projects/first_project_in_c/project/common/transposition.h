@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "common/sumset.h"
+
+// A fixed-size table of visited search states (A^Σ, last of A, B^Σ, last of B), shared by threads without locks.
+// The subtree of a state only depends on these, so once it's explored (or being explored), another thread
+// reaching the same state from different multisets can skip it: it has the same solution sums, already
+// recorded by the first visit. Only for --bound, since the reference traversal visits every node.
+//
+// Each bucket has two entries: the first keeps the state closest to the root (the biggest subtree),
+// the second is always replaced. Entries only hold a 50-bit fingerprint of the state and its depth,
+// races between threads can only lose entries (the state is then explored again).
+typedef struct TranspositionTable {
+    _Atomic uint64_t* entries; // 2 per bucket, 0 for empty, NULL if the table is disabled
+    size_t mask; // Number of buckets - 1
+} TranspositionTable;
+
+// Hash the search state (a, b) (sumsets, sums and lasts) and seed into two independent 64-bit hashes.
+// Only reads the words up to the sums, so it works for sumsets built with SUMSET_BOUNDED.
+void state_hash(const Sumset* a, const Sumset* b, uint64_t seed, uint64_t hash[2]);
+
+// Allocate a table taking at most mib MiB (the biggest power of two of buckets that fits), disabled if mib is 0.
+void transposition_init(TranspositionTable* table, size_t mib);
+
+void transposition_free(TranspositionTable* table);
+
+// Return whether the state (a, b) was already visited, and record it otherwise.
+// a is the sumset extended by the children (a->sum <= b->sum).
+bool transposition_visit(TranspositionTable* table, const Sumset* a, const Sumset* b);
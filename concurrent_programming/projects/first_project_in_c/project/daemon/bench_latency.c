@@ -0,0 +1,123 @@
+// Times the requests of a running daemon: for each d from 3 to --max-d, sends --requests requests of the input
+// "t d 0 1 / (empty) / 1" from --clients connections at once and prints, as CSV, the mean, the median and the 99th
+// percentile of the latency (from connecting to the end of the reply) in µs. Usage:
+//   bench_latency --socket PATH [--max-d N] [--requests N] [--clients N] [--threads T] [--bound]
+// Defaults: d up to 20, 50 requests, 1 client, t = 1. Not run by ctest.
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "common/err.h"
+#include "common/socket.h"
+
+typedef struct {
+    const char* socket_path;
+    const char* request;
+    int count;
+    double* latencies; // In µs, count of them
+} Client;
+
+static int parse_count(const char* text, const char* name)
+{
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || value < 1 || value > 100000)
+        fatal("%s needs a number in 1..100000", name);
+    return value;
+}
+
+static double now_us(void)
+{
+    struct timespec now;
+    ASSERT_SYS_OK(clock_gettime(CLOCK_MONOTONIC, &now));
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+static void* run_client(void* arg)
+{
+    Client* client = arg;
+    char reply[4096];
+    for (int i = 0; i < client->count; ++i) {
+        double start = now_us();
+        int fd = socket_connect(client->socket_path);
+        if (!socket_send(fd, client->request, strlen(client->request)))
+            fatal("The daemon closed the connection");
+        ASSERT_SYS_OK(shutdown(fd, SHUT_WR));
+        if (socket_receive_all(fd, reply, sizeof(reply)) <= 0 || strncmp(reply, "ERROR", 5) == 0)
+            fatal("Bad reply: %s", reply);
+        ASSERT_SYS_OK(close(fd));
+        client->latencies[i] = now_us() - start;
+    }
+    return NULL;
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* socket_path = NULL;
+    int max_d = 20, requests = 50, clients = 1, threads = 1;
+    bool bound = false;
+    for (int i = 1; i < argc; i++) {
+        const char* option = argv[i];
+        if (strcmp(option, "--bound") == 0)
+            bound = true;
+        else if (i + 1 == argc)
+            fatal("%s needs a value", option);
+        else if (strcmp(option, "--socket") == 0)
+            socket_path = argv[++i];
+        else if (strcmp(option, "--max-d") == 0)
+            max_d = parse_count(argv[++i], option);
+        else if (strcmp(option, "--requests") == 0)
+            requests = parse_count(argv[++i], option);
+        else if (strcmp(option, "--clients") == 0)
+            clients = parse_count(argv[++i], option);
+        else if (strcmp(option, "--threads") == 0)
+            threads = parse_count(argv[++i], option);
+        else
+            fatal("Unknown option: %s", option);
+    }
+    if (socket_path == NULL)
+        fatal("Usage: bench_latency --socket PATH [--max-d N] [--requests N] [--clients N] [--threads T] [--bound]");
+    if (clients > requests)
+        clients = requests;
+
+    double* latencies = malloc(sizeof(double) * requests);
+    Client* client_data = malloc(sizeof(Client) * clients);
+    pthread_t* client_threads = malloc(sizeof(pthread_t) * clients);
+    if (latencies == NULL || client_data == NULL || client_threads == NULL)
+        exit(1);
+    printf("d,threads,bound,requests,clients,mean_us,p50_us,p99_us\n");
+    for (int d = 3; d <= max_d; ++d) {
+        char request[64];
+        snprintf(request, sizeof(request), "%s%d %d 0 1\n\n1\n", bound ? "--bound\n" : "", threads, d);
+        // The requests are split between the clients as evenly as possible
+        for (int k = 0, first = 0; k < clients; ++k) {
+            int count = requests / clients + (k < requests % clients);
+            client_data[k] = (Client){ socket_path, request, count, latencies + first };
+            first += count;
+            ASSERT_ZERO(pthread_create(&client_threads[k], NULL, run_client, &client_data[k]));
+        }
+        for (int k = 0; k < clients; ++k)
+            ASSERT_ZERO(pthread_join(client_threads[k], NULL));
+
+        double sum = 0;
+        for (int i = 0; i < requests; ++i)
+            sum += latencies[i];
+        qsort(latencies, requests, sizeof(double), compare_doubles);
+        printf("%d,%d,%d,%d,%d,%.1f,%.1f,%.1f\n", d, threads, bound, requests, clients, sum / requests,
+               latencies[(requests - 1) / 2], latencies[(requests - 1) * 99 / 100]);
+        fflush(stdout);
+    }
+    free(client_threads);
+    free(client_data);
+    free(latencies);
+    return 0;
+}
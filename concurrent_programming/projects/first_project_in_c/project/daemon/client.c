@@ -0,0 +1,53 @@
+// Sends the input on stdin to the daemon as one request and prints the reply. Usage:
+//   daemon_client --socket PATH [--bound]
+// Exits with 1 if the daemon rejects the request (its message is printed to stderr).
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "common/err.h"
+#include "common/socket.h"
+
+// Longest input and reply, as in the daemon
+#define CLIENT_MAX_TEXT (64 << 10)
+
+int main(int argc, char* argv[])
+{
+    const char* socket_path = NULL;
+    bool bound = false;
+    for (int i = 1; i < argc; i++) {
+        const char* option = argv[i];
+        if (strcmp(option, "--bound") == 0)
+            bound = true;
+        else if (strcmp(option, "--socket") == 0 && i + 1 < argc)
+            socket_path = argv[++i];
+        else
+            fatal("Usage: daemon_client --socket PATH [--bound]");
+    }
+    if (socket_path == NULL)
+        fatal("Usage: daemon_client --socket PATH [--bound]");
+
+    static char text[CLIENT_MAX_TEXT];
+    size_t length = fread(text, 1, sizeof(text), stdin);
+    if (ferror(stdin) || length == sizeof(text))
+        fatal("Cannot read the input, or it's too long");
+
+    int fd = socket_connect(socket_path);
+    static const char bound_option[] = "--bound\n";
+    if ((bound && !socket_send(fd, bound_option, strlen(bound_option))) || !socket_send(fd, text, length))
+        fatal("The daemon closed the connection");
+    ASSERT_SYS_OK(shutdown(fd, SHUT_WR));
+    if (socket_receive_all(fd, text, sizeof(text)) < 0)
+        fatal("Reply too long");
+    ASSERT_SYS_OK(close(fd));
+
+    if (text[0] == '\0')
+        fatal("No reply from the daemon");
+    if (strncmp(text, "ERROR", strlen("ERROR")) == 0) {
+        fputs(text, stderr);
+        return 1;
+    }
+    fputs(text, stdout);
+    return 0;
+}
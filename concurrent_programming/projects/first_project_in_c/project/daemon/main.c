@@ -0,0 +1,218 @@
+// A long-lived solver: keeps one pool of threads (see nonrecursive/pool.h) and solves the requests of clients
+// on a Unix domain socket, several at once. Usage:
+//   daemon --socket PATH [--threads N] [--memory-mib N]
+// A request is the input of reference (t, d, n, m, A_0, B_0), optionally after --bound, sent whole before the
+// client shuts down its side of the connection. The reply is the output of reference, or one line starting with
+// ERROR. The pool has N threads (default: the number of CPUs), of which a request uses at most t at once.
+// Each request gets at most --memory-mib MiB for its subtrees and searches (default 64, 0 for no limit).
+// The daemon runs until SIGINT or SIGTERM, which remove the socket.
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "common/err.h"
+#include "common/io.h"
+#include "common/socket.h"
+#include "nonrecursive/pool.h"
+#include "nonrecursive/solve.h"
+
+// Longest request accepted, far above the longest valid input
+#define DAEMON_MAX_REQUEST (64 << 10)
+// As in input_data_read(), d is in 3..MAX_D and the elements of A_0 and B_0 in 1..d. The sums of the search reach
+// d * d plus the sums of A_0 and B_0, which must stay below MAX_BITS (asserted by sumset_add()), so there are fewer
+// than MAX_BITS elements.
+#define DAEMON_MAX_ELEMENTS MAX_BITS
+#define DAEMON_STRING(x) #x
+#define DAEMON_NUMBER(x) DAEMON_STRING(x)
+
+typedef struct {
+    SolvePool* pool;
+    size_t memory_limit;
+    int fd;
+} Connection;
+
+static const char* socket_path;
+
+static int parse_count(const char* text, const char* name, int max)
+{
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || value < 0 || value > max)
+        fatal("%s needs a number in 0..%d", name, max);
+    return value;
+}
+
+// Reads the next number of the request into value. Returns false if there is none.
+static bool next_number(char** text, long* value)
+{
+    char* end;
+    *value = strtol(*text, &end, 10);
+    if (end == *text)
+        return false;
+    *text = end;
+    return true;
+}
+
+// Reads count elements in 1..d into elements (terminated with 0, as input_data_init() takes them), adding them
+// to *sum. Returns an error message, or NULL.
+static const char* parse_elements(char** text, long count, int d, int elements[], long* sum)
+{
+    if (count < 0 || count > DAEMON_MAX_ELEMENTS)
+        return "Bad number of elements";
+    for (long i = 0; i < count; ++i) {
+        long x;
+        if (!next_number(text, &x))
+            return "Missing elements";
+        if (x < 1 || x > d)
+            return "Element out of 1..d";
+        elements[i] = x;
+        *sum += x;
+    }
+    elements[count] = 0;
+    return NULL;
+}
+
+// Parses a request into instance. Returns an error message, or NULL.
+static const char* parse_request(char* text, PoolInstance* instance)
+{
+    static const char bound_option[] = "--bound";
+    while (*text == ' ' || *text == '\t' || *text == '\n' || *text == '\r')
+        ++text;
+    instance->bound = strncmp(text, bound_option, strlen(bound_option)) == 0;
+    if (instance->bound)
+        text += strlen(bound_option);
+
+    long t, d, n, m;
+    if (!next_number(&text, &t) || !next_number(&text, &d) || !next_number(&text, &n) || !next_number(&text, &m))
+        return "Expected t d n m";
+    if (t < 1 || t > 4096)
+        return "t out of 1..4096";
+    if (d < 3 || d > MAX_D)
+        return "d out of 3.." DAEMON_NUMBER(MAX_D);
+    int a_elements[DAEMON_MAX_ELEMENTS + 1], b_elements[DAEMON_MAX_ELEMENTS + 1];
+    long sum = 0;
+    const char* error = parse_elements(&text, n, d, a_elements, &sum);
+    if (error == NULL)
+        error = parse_elements(&text, m, d, b_elements, &sum);
+    if (error != NULL)
+        return error;
+    if (d * d + sum >= MAX_BITS)
+        return "Sums of A_0 and B_0 too big for d";
+    while (*text == ' ' || *text == '\t' || *text == '\n' || *text == '\r')
+        ++text;
+    if (*text != '\0')
+        return "Unexpected text after B_0";
+
+    // input_data_init() doesn't clear the count of MAX_D
+    memset(&instance->input_data, 0, sizeof(instance->input_data));
+    input_data_init(&instance->input_data, t, d, a_elements, b_elements);
+    return NULL;
+}
+
+static void reply(int fd, const char* text, size_t length)
+{
+    // The client may be gone already, nothing to do then
+    socket_send(fd, text, length);
+}
+
+static void* serve(void* arg)
+{
+    Connection* connection = arg;
+    char* request = malloc(DAEMON_MAX_REQUEST);
+    PoolInstance* instance = malloc(sizeof(PoolInstance));
+    if (request == NULL || instance == NULL)
+        exit(1);
+    *instance = (PoolInstance){ .memory_limit = connection->memory_limit };
+
+    char error[128];
+    const char* message = NULL;
+    if (socket_receive_all(connection->fd, request, DAEMON_MAX_REQUEST) < 0)
+        message = "Request too long";
+    else
+        message = parse_request(request, instance);
+    if (message == NULL && !pool_submit(connection->pool, instance))
+        message = "Memory limit too small for one search";
+
+    if (message != NULL) {
+        int length = snprintf(error, sizeof(error), "ERROR: %s\n", message);
+        reply(connection->fd, error, length);
+    } else {
+        pool_wait(connection->pool, instance);
+        char* text;
+        size_t length;
+        FILE* output = open_memstream(&text, &length);
+        if (output == NULL)
+            exit(1);
+        solution_fprint(output, &instance->best_solution);
+        ASSERT_ZERO(fclose(output));
+        reply(connection->fd, text, length);
+        free(text);
+    }
+    ASSERT_SYS_OK(close(connection->fd));
+    free(instance);
+    free(request);
+    free(connection);
+    return NULL;
+}
+
+// Removes the socket and exits on SIGINT or SIGTERM (blocked in all the other threads).
+static void* wait_for_signal(void* arg)
+{
+    sigset_t* signals = arg;
+    int received;
+    ASSERT_ZERO(sigwait(signals, &received));
+    unlink(socket_path);
+    exit(0);
+}
+
+int main(int argc, char* argv[])
+{
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int memory_mib = 64;
+    for (int i = 1; i < argc; i++) {
+        const char* option = argv[i];
+        if (i + 1 == argc)
+            fatal("%s needs a value", option);
+        else if (strcmp(option, "--socket") == 0)
+            socket_path = argv[++i];
+        else if (strcmp(option, "--threads") == 0)
+            threads = parse_count(argv[++i], option, 4096);
+        else if (strcmp(option, "--memory-mib") == 0)
+            memory_mib = parse_count(argv[++i], option, 1 << 20);
+        else
+            fatal("Unknown option: %s", option);
+    }
+    if (socket_path == NULL)
+        fatal("Usage: daemon --socket PATH [--threads N] [--memory-mib N]");
+    if (threads < 1)
+        threads = 1;
+
+    static sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    ASSERT_ZERO(pthread_sigmask(SIG_BLOCK, &signals, NULL));
+    pthread_t signal_thread;
+    ASSERT_ZERO(pthread_create(&signal_thread, NULL, wait_for_signal, &signals));
+
+    // The threads and their stacks are started once, requests only queue subtrees
+    static SolvePool pool;
+    pool_init(&pool, threads);
+    int listener = socket_listen(socket_path);
+    fprintf(stderr, "Listening on %s with %d threads\n", socket_path, threads);
+
+    pthread_attr_t attr;
+    ASSERT_ZERO(pthread_attr_init(&attr));
+    ASSERT_ZERO(pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED));
+    while (true) {
+        int fd = socket_accept(listener);
+        Connection* connection = malloc(sizeof(Connection));
+        if (connection == NULL)
+            exit(1);
+        *connection = (Connection){ &pool, (size_t)memory_mib << 20, fd };
+        pthread_t thread;
+        ASSERT_ZERO(pthread_create(&thread, &attr, serve, connection));
+    }
+}
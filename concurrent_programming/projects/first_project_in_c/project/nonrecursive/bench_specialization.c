@@ -0,0 +1,51 @@
+// Compares the search specialized for d with the generic one, on A_0 = B_0 = ∅ for each d.
+// Usage: bench_specialization [max_d (default 20)] [repetitions (default 3)]
+// Prints, for each d, the number of sumset words, the best time of each version and the speedup.
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "common/err.h"
+#include "common/io.h"
+#include "nonrecursive/solve.h"
+
+static double best_time(SolveNonrecursive solve, InputData* input_data, int repetitions, int* sum)
+{
+    double best = 0;
+    for (int r = 0; r < repetitions; ++r) {
+        Solution solution;
+        solution_init(&solution);
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        solve(input_data, false, 0, NULL, NULL, &solution);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+        if (r == 0 || ms < best)
+            best = ms;
+        *sum = solution.sum;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[])
+{
+    int max_d = (argc > 1) ? atoi(argv[1]) : 20;
+    int repetitions = (argc > 2) ? atoi(argv[2]) : 3;
+    if (max_d < 3 || max_d > MAX_D || repetitions < 1)
+        fatal("Usage: %s [max_d in 3..%d] [repetitions]", argv[0], MAX_D);
+
+    printf("%4s %6s %14s %16s %8s\n", "d", "words", "generic [ms]", "specialized [ms]", "speedup");
+    for (int d = 3; d <= max_d; ++d) {
+        InputData input_data;
+        input_data_init(&input_data, 1, d, (int[]){0}, (int[]){0});
+
+        int generic_sum, specialized_sum;
+        double generic = best_time(solve_nonrecursive_generic, &input_data, repetitions, &generic_sum);
+        double specialized = best_time(solve_nonrecursive_for(&input_data), &input_data, repetitions, &specialized_sum);
+        if (generic_sum != specialized_sum)
+            fatal("d=%d: the specialized search found %d instead of %d", d, specialized_sum, generic_sum);
+
+        printf("%4d %6d %14.2f %16.2f %7.2fx\n", d, solve_nonrecursive_words(&input_data), generic, specialized,
+               generic / specialized);
+    }
+    return 0;
+}
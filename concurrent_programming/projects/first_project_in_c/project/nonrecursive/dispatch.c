@@ -0,0 +1,17 @@
+#include "nonrecursive/solve.h"
+#include "nonrecursive/specializations.h"
+
+int solve_nonrecursive_words(const InputData* input_data)
+{
+    int bits = input_data->d * input_data->d + input_data->a_start.sum + input_data->b_start.sum;
+    return (bits + BITS_PER_WORD - 1) / BITS_PER_WORD;
+}
+
+SolveNonrecursive solve_nonrecursive_for(const InputData* input_data)
+{
+    int words = solve_nonrecursive_words(input_data);
+    for (size_t i = 0; i < sizeof(specializations) / sizeof(specializations[0]); ++i)
+        if (specializations[i].words >= words)
+            return specializations[i].solve;
+    return solve_nonrecursive_generic;
+}
@@ -1,129 +1,111 @@
-#include <stddef.h>
-#include <stdlib.h>
+#include "common/bound.h"
+#include "common/checkpoint.h"
+#include "common/deadline.h"
 #include "common/io.h"
-#include "common/sumset.h"
-
-typedef struct {
-    Sumset a;
-    Sumset* b;
-    // if I am the last child of my father, pop the father
-    bool last;
-} StackFrame;
-
-typedef struct {
-    StackFrame* frames;
-    size_t size;
-    size_t capacity;
-} Stack;
-
-void stack_init(Stack* stack, size_t d) {
-    // It can be shown that this size of stack is enough 
-    size_t capacity = d * d;
-    stack->frames = malloc(sizeof(StackFrame) * capacity);
-    if (!stack->frames) {
-        exit(1);
-    }
-    stack->size = 0;
-    stack->capacity = capacity;
-}
-
-void stack_free(Stack* stack) {
-    free(stack->frames);
-}
-
-void stack_push(Stack* stack, const Sumset* a, Sumset* b, bool last) {
-    if (stack->size == stack->capacity) {
-        stack_free(stack);
-        exit(1);
-    }
-    stack->frames[stack->size++] = (StackFrame){ *a, b, last };
-}
-
-void stack_push_create(Stack* stack, const Sumset* a, Sumset* b, bool last, size_t i) {
-    if (stack->size == stack->capacity) {
-        stack_free(stack);
-        exit(1);
-    }
-    sumset_add(&stack->frames[stack->size].a, a, i);
-    stack->frames[stack->size].b = b;
-    stack->frames[stack->size].last = last;
-    stack->size++;
-}
-
-void stack_pop(Stack* stack) {
-    if (stack->size > 0) {
-        stack->size--;
-    }
-}
-
+#include "common/options.h"
+#include "common/stats.h"
+#include "nonrecursive/solve.h"
+#include "nonrecursive/sweep.h"
+
+static Options options;
+// Static: input_data_read() leaves the count of MAX_D as it was, and checkpoints compare the counts
+static InputData input_data;
 static Solution best_solution;
 
-void solve_nonrecursive(InputData* input_data) {
-    Stack stack;
-    stack_init(&stack, input_data->d);
-
-    stack_push(&stack, &input_data->a_start, &input_data->b_start, false);
-
-    while (stack.size > 0) {
-        bool leaf = true;   // checks if a given sumsets will produce new
-        // case or not (then it is a leaf)
-        bool last = true;   // info which of our children will be the last to be
-        // calculated and should pop ancestors if they were also last children
-        // of theirs
-        Sumset* a = &stack.frames[stack.size - 1].a;
-        Sumset* b = stack.frames[stack.size - 1].b;
-
-        if (stack.frames[stack.size - 1].a.sum > stack.frames[stack.size - 1].b->sum) {
-            Sumset* temp = a;
-            a = b;
-            b = temp;
-        }
-
-        if (is_sumset_intersection_trivial(a, b)) {   // s(a) ∩ s(b) = {0}.
-            // we change the order in for to have the same
-            // dfs as in reference
-            for (size_t i = input_data->d; i >= a->last; --i) {
-                if (!does_sumset_contain(b, i)) {
-                    leaf = false;
-
-                    stack_push_create(&stack, a, b, last, i);
-
-                    if (last)
-                        last = false;
-                }
-            }
-        } else if ((a->sum == b->sum) && (get_sumset_intersection_size(a, b) == 2)) { // s(a) ∩ s(b) = {0, ∑b}.
-            if (b->sum > best_solution.sum)
-                solution_build(&best_solution, input_data, a, b);
+// Searches the frames of the checkpoint one subtree at a time, each from an input whose start sumsets are its node.
+// The checkpointer writes the frames not started yet after the frontier of the subtree being searched.
+static void resume(SolveNonrecursive solve, const InputData* input_data, const Checkpoint* resumed, int ceiling,
+                   SubtreeCache* cache, Checkpointer* checkpointer)
+{
+    // Static: the checkpointer keeps pointing to them
+    static InputData node, task_input;
+    checkpointer->resumed = resumed;
+    checkpointer->roots = &task_input;
+    for (size_t k = 0; k < resumed->frame_count; ++k) {
+        CheckpointFrame frame = checkpoint_frame(resumed, k);
+        checkpointer->resumed_frame = k;
+        // The stopped search wrote the frames left
+        if (deadline_stopped())
+            return;
+        if (frame.first == 0) {
+            checkpointer->resumed_next = frame.end + 1;
+            checkpoint_frame_input(&frame, 0, input_data, &task_input);
+            solve(&task_input, options.bound, ceiling, cache, checkpointer, &best_solution);
+            continue;
         }
 
-        // leafs should pop themselves
-        // if they are last leafs, they should pop their father
-        // if they are last leafs and their father was also last,
-        // grandfather also should be popped and if grandfather
-        // was also last etc.
-        if (leaf) {
-            last = stack.frames[stack.size - 1].last;
-            stack_pop(&stack);
-            while (last) {
-                last = stack.frames[stack.size - 1].last;
-                stack_pop(&stack);
-            }
+        checkpoint_frame_input(&frame, 0, input_data, &node);
+        const Sumset* extended = frame.extends_b ? &node.b_start : &node.a_start;
+        const Sumset* other = frame.extends_b ? &node.a_start : &node.b_start;
+        for (int x = frame.first; x <= frame.end; ++x) {
+            if ((options.bound && best_solution.sum >= ceiling) || deadline_stopped())
+                return;
+            if (x < extended->last || does_sumset_contain(other, x))
+                continue;
+            checkpointer->resumed_next = x + 1;
+            checkpoint_frame_input(&frame, x, input_data, &task_input);
+            solve(&task_input, options.bound, ceiling, cache, checkpointer, &best_solution);
         }
     }
-
-    stack_free(&stack);
 }
 
-int main() {
-    InputData input_data;
+int main(int argc, char* argv[]) {
+    options_parse(&options, argc, argv);
+    deadline_start(options.deadline_ms, NULL);
     input_data_read(&input_data);
     // input_data_init(&input_data, 1, 3, (int[]){0}, (int[]){0});
+    if (options.sweep) {
+        static Solution best_solutions[MAX_D + 1];
+        stats_thread_start();
+        sweep_run(&input_data, options.bound, best_solutions);
+        stats_thread_stop();
+        stats_print();
+        // A block per d: the line "d <d>", then the output of the search of that d
+        for (int d = sweep_first_d(&input_data); d <= input_data.d; ++d) {
+            printf("d %d\n", d);
+            solution_print(&best_solutions[d]);
+        }
+        return 0;
+    }
 
     solution_init(&best_solution);
+    // With --bound: no solution has a bigger sum than ceiling
+    int ceiling = 0;
+    if (options.bound) {
+        ceiling = alpha_ceiling(&input_data);
+        solution_seed(&best_solution, &input_data);
+    }
 
-    solve_nonrecursive(&input_data);
+    // The search compiled for as few sumset words as the sums of this input need
+    SolveNonrecursive solve = options.generic ? solve_nonrecursive_generic : solve_nonrecursive_for(&input_data);
+    SubtreeCache cache;
+    cache_open(&cache, options.cache_path, input_data.d);
+    Checkpoint resumed;
+    checkpoint_init(&resumed);
+    if (options.resume)
+        checkpoint_read(&resumed, options.checkpoint_path, &input_data, options.bound, ceiling, &best_solution);
+    Checkpointer checkpointer;
+    checkpointer_init(&checkpointer, options.checkpoint_path, options.checkpoint_seconds, &input_data, options.bound,
+                      ceiling);
+
+    stats_thread_start();
+    SubtreeCache* used_cache = cache_enabled(&cache) ? &cache : NULL;
+    Checkpointer* used_checkpointer = checkpointer_enabled(&checkpointer) ? &checkpointer : NULL;
+    // The subtrees of a checkpoint have the same sums as in the whole search, so the same specialization fits
+    if (options.resume)
+        resume(solve, &input_data, &resumed, ceiling, used_cache, &checkpointer);
+    else
+        solve(&input_data, options.bound, ceiling, used_cache, used_checkpointer, &best_solution);
+    stats_thread_stop();
+    // A stopped search keeps its checkpoint for --resume
+    if (!deadline_stopped())
+        checkpointer_finish(&checkpointer);
+    checkpointer_free(&checkpointer);
+    checkpoint_free(&resumed);
+    cache_close(&cache);
+    stats_print();
 
     solution_print(&best_solution);
+    deadline_print();
     return 0;
-}
\ No newline at end of file
+}
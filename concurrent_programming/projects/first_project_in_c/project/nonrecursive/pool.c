@@ -0,0 +1,249 @@
+#include "nonrecursive/pool.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common/bound.h"
+#include "common/err.h"
+#include "common/stats.h"
+#include "nonrecursive/solve.h"
+
+// Instances with at least this d are split, smaller ones are searched faster than a split costs
+#define POOL_SPLIT_MIN_D 20
+// A split instance gets this many subtrees per thread, so that the last instances also keep all threads busy
+#define POOL_SUBTREES_PER_THREAD 4
+// The split stops after this many levels, even with fewer subtrees
+#define POOL_MAX_SPLIT_DEPTH 8
+
+// Sets subtree to the input of the search of node: the start sumsets are those of the node, and the elements
+// added on the way to it are in a_in and b_in.
+static void subtree_of(const InputData* input_data, SolveNode node, InputData* subtree)
+{
+    *subtree = *input_data;
+    for (const Sumset* p = node.a; p->prev != NULL; p = p->prev)
+        subtree->a_in.count[p->sum - p->prev->sum]++;
+    for (const Sumset* p = node.b; p->prev != NULL; p = p->prev)
+        subtree->b_in.count[p->sum - p->prev->sum]++;
+    subtree->a_start = *node.a;
+    subtree->b_start = *node.b;
+    subtree->a_start.prev = NULL;
+    subtree->b_start.prev = NULL;
+}
+
+// Splits the instance into at least target subtrees if it can, while they fit in available bytes (with 0 for no
+// limit) next to one search. Returns them in *subtrees, allocated.
+static int split_instance(PoolInstance* instance, int target, size_t available, InputData** subtrees)
+{
+    const InputData* input_data = &instance->input_data;
+    int d = input_data->d;
+    // The levels of the expansion, the later ones point to the sumsets of the earlier ones
+    SolveNode* nodes[POOL_MAX_SPLIT_DEPTH + 1];
+    Sumset* sumsets[POOL_MAX_SPLIT_DEPTH + 1];
+    int depth = 0, count = 1;
+    nodes[0] = malloc(sizeof(SolveNode));
+    sumsets[0] = NULL;
+    if (nodes[0] == NULL)
+        exit(1);
+    nodes[0][0] = (SolveNode){ &input_data->a_start, &input_data->b_start };
+    size_t used = 0;
+    // Only the root can have a non-trivial intersection, the search handles it
+    bool trivial = is_sumset_intersection_trivial(&input_data->a_start, &input_data->b_start);
+    while (trivial && depth < POOL_MAX_SPLIT_DEPTH && count > 0 && count < target) {
+        // The levels and the subtrees of the last one are in memory at once
+        size_t level = (sizeof(SolveNode) + sizeof(Sumset) + sizeof(InputData)) * count * d;
+        if (available != 0 && used + level > available)
+            break;
+        used += (sizeof(SolveNode) + sizeof(Sumset)) * count * d;
+        nodes[depth + 1] = malloc(sizeof(SolveNode) * count * d);
+        sumsets[depth + 1] = malloc(sizeof(Sumset) * count * d);
+        if (nodes[depth + 1] == NULL || sumsets[depth + 1] == NULL)
+            exit(1);
+        count = solve_nonrecursive_expand(input_data, instance->bound, instance->ceiling, nodes[depth], count,
+                                          nodes[depth + 1], sumsets[depth + 1], NULL);
+        ++depth;
+    }
+
+    *subtrees = malloc(sizeof(InputData) * (count > 0 ? count : 1));
+    if (*subtrees == NULL)
+        exit(1);
+    for (int k = 0; k < count; ++k)
+        subtree_of(input_data, nodes[depth][k], &(*subtrees)[k]);
+    for (int k = 0; k <= depth; ++k) {
+        free(nodes[k]);
+        free(sumsets[k]);
+    }
+    return count;
+}
+
+// Takes the next subtree from the queued instances in turn, skipping those with max_running threads already
+// (called with the mutex locked). Returns its instance and sets *index to its index, or returns NULL if there is
+// none to take.
+static PoolInstance* take_subtree(SolvePool* pool, InputData* subtree, int* index)
+{
+    for (int k = 0; k < pool->queued_count; ++k) {
+        int i = (pool->turn + k) % pool->queued_count;
+        PoolInstance* instance = pool->queued[i];
+        if (instance->running == instance->max_running)
+            continue;
+        *index = instance->subtree_next;
+        *subtree = instance->subtrees[instance->subtree_next++];
+        instance->running++;
+        pool->turn = i + 1;
+        if (instance->subtree_next == instance->subtree_count) {
+            free(instance->subtrees);
+            instance->subtrees = NULL;
+            memmove(&pool->queued[i], &pool->queued[i + 1], sizeof(PoolInstance*) * (pool->queued_count - i - 1));
+            pool->queued_count--;
+            // The next instance moved to i
+            pool->turn = i;
+        }
+        return instance;
+    }
+    return NULL;
+}
+
+static void* pool_worker(void* arg)
+{
+    SolvePool* pool = arg;
+    InputData subtree;
+    int index;
+    stats_thread_start();
+    ASSERT_ZERO(pthread_mutex_lock(&pool->mutex));
+    while (true) {
+        PoolInstance* instance;
+        while ((instance = take_subtree(pool, &subtree, &index)) == NULL && !(pool->stopping && pool->queued_count == 0))
+            ASSERT_ZERO(pthread_cond_wait(&pool->subtree_ready, &pool->mutex));
+        if (instance == NULL)
+            break;
+        // With bound, the search stops once the best solution of the instance reaches the ceiling. Otherwise it
+        // starts empty, so that it finds the first of the best solutions of its subtree.
+        Solution solution;
+        if (instance->bound)
+            solution = instance->best_solution;
+        else
+            solution_init(&solution);
+        ASSERT_ZERO(pthread_mutex_unlock(&pool->mutex));
+
+        solve_nonrecursive_for(&subtree)(&subtree, instance->bound, instance->ceiling, NULL, NULL, &solution);
+
+        ASSERT_ZERO(pthread_mutex_lock(&pool->mutex));
+        // The subtrees finish in any order, on equal sums the first one in the order of the search wins, as in reference
+        if (solution.sum > instance->best_solution.sum
+            || (solution.sum == instance->best_solution.sum && index < instance->best_subtree)) {
+            instance->best_solution = solution;
+            instance->best_subtree = index;
+        }
+        // Another thread can take a subtree of the instance now
+        if (instance->running-- == instance->max_running && instance->subtree_next < instance->subtree_count)
+            ASSERT_ZERO(pthread_cond_signal(&pool->subtree_ready));
+        if (--instance->pending == 0)
+            ASSERT_ZERO(pthread_cond_broadcast(&pool->instance_solved));
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&pool->mutex));
+    stats_thread_stop();
+    return NULL;
+}
+
+void pool_init(SolvePool* pool, int threads)
+{
+    *pool = (SolvePool){ .thread_count = threads };
+    ASSERT_ZERO(pthread_mutex_init(&pool->mutex, NULL));
+    ASSERT_ZERO(pthread_cond_init(&pool->subtree_ready, NULL));
+    ASSERT_ZERO(pthread_cond_init(&pool->instance_solved, NULL));
+    pool->threads = malloc(sizeof(pthread_t) * threads);
+    if (pool->threads == NULL)
+        exit(1);
+    for (int i = 0; i < threads; ++i)
+        ASSERT_ZERO(pthread_create(&pool->threads[i], NULL, pool_worker, pool));
+}
+
+void pool_free(SolvePool* pool)
+{
+    ASSERT_ZERO(pthread_mutex_lock(&pool->mutex));
+    pool->stopping = true;
+    ASSERT_ZERO(pthread_cond_broadcast(&pool->subtree_ready));
+    ASSERT_ZERO(pthread_mutex_unlock(&pool->mutex));
+    for (int i = 0; i < pool->thread_count; ++i)
+        ASSERT_ZERO(pthread_join(pool->threads[i], NULL));
+
+    free(pool->threads);
+    free(pool->queued);
+    ASSERT_ZERO(pthread_cond_destroy(&pool->instance_solved));
+    ASSERT_ZERO(pthread_cond_destroy(&pool->subtree_ready));
+    ASSERT_ZERO(pthread_mutex_destroy(&pool->mutex));
+}
+
+bool pool_submit(SolvePool* pool, PoolInstance* instance)
+{
+    const InputData* input_data = &instance->input_data;
+    instance->ceiling = 0;
+    solution_init(&instance->best_solution);
+    if (instance->bound) {
+        instance->ceiling = alpha_ceiling(input_data);
+        solution_seed(&instance->best_solution, input_data);
+    }
+
+    // A running search takes its stack and a copy of its subtree
+    size_t search = solve_nonrecursive_memory(input_data) + sizeof(InputData);
+    size_t limit = instance->memory_limit;
+    if (limit != 0 && sizeof(PoolInstance) + search > limit)
+        return false;
+    size_t available = (limit == 0) ? 0 : limit - sizeof(PoolInstance) - search;
+
+    int max_running = (input_data->t < 1) ? 1 : input_data->t;
+    if (max_running > pool->thread_count)
+        max_running = pool->thread_count;
+    InputData* subtrees = NULL;
+    int count = 0;
+    if (!(instance->bound && instance->best_solution.sum >= instance->ceiling)) {
+        int target = (input_data->d >= POOL_SPLIT_MIN_D) ? POOL_SUBTREES_PER_THREAD * max_running : 1;
+        count = split_instance(instance, target, available, &subtrees);
+    }
+    if (count == 0) {
+        free(subtrees);
+        subtrees = NULL;
+    }
+    // The subtrees take the place of the first level in the limit, the rest is for the searches running at once
+    if (limit != 0) {
+        size_t searches = (limit - sizeof(PoolInstance) - sizeof(InputData) * count) / search;
+        if (searches < (size_t)max_running)
+            max_running = (searches < 1) ? 1 : searches;
+    }
+
+    ASSERT_ZERO(pthread_mutex_lock(&pool->mutex));
+    instance->subtrees = subtrees;
+    instance->subtree_next = 0;
+    instance->subtree_count = count;
+    instance->best_subtree = INT_MAX;
+    instance->pending = count;
+    instance->max_running = max_running;
+    instance->running = 0;
+    if (count > 0) {
+        if (pool->queued_count == pool->queued_capacity) {
+            pool->queued_capacity = (pool->queued_capacity == 0) ? 256 : 2 * pool->queued_capacity;
+            pool->queued = realloc(pool->queued, sizeof(PoolInstance*) * pool->queued_capacity);
+            if (pool->queued == NULL)
+                exit(1);
+        }
+        pool->queued[pool->queued_count++] = instance;
+        ASSERT_ZERO(pthread_cond_broadcast(&pool->subtree_ready));
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&pool->mutex));
+    return true;
+}
+
+bool pool_solved(SolvePool* pool, const PoolInstance* instance)
+{
+    ASSERT_ZERO(pthread_mutex_lock(&pool->mutex));
+    bool solved = (instance->pending == 0);
+    ASSERT_ZERO(pthread_mutex_unlock(&pool->mutex));
+    return solved;
+}
+
+void pool_wait(SolvePool* pool, const PoolInstance* instance)
+{
+    ASSERT_ZERO(pthread_mutex_lock(&pool->mutex));
+    while (instance->pending > 0)
+        ASSERT_ZERO(pthread_cond_wait(&pool->instance_solved, &pool->mutex));
+    ASSERT_ZERO(pthread_mutex_unlock(&pool->mutex));
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "common/io.h"
+
+// A pool of threads solving many instances at once with the search of nonrecursive (used by parallel --batch
+// and by the daemon).
+//
+// A submitted instance is split into subtrees: instances with small d are one subtree, bigger ones are split
+// into the nodes of the first levels of their search. The threads take the next subtree of the queued instances
+// in turn, so a big instance doesn't hold up the ones submitted after it. At most t threads (t of the instance)
+// search the subtrees of one instance at once. On equal sums, the best solution is the one of the first subtree in
+// the order of the search, so it's the solution reference prints.
+// With bound, as in the other solvers: subtrees above the ceiling of their instance are skipped.
+
+typedef struct PoolInstance {
+    // Set before pool_submit()
+    InputData input_data;
+    bool bound;
+    size_t memory_limit; // Bytes for the subtrees and the searches of the instance, 0 for no limit
+    // The result, once the instance is solved
+    Solution best_solution;
+    // Set by the pool
+    int ceiling;
+    int best_subtree; // The subtree best_solution was found in, ties go to the first one in the order of the search
+    int max_running, running; // Threads searching its subtrees at once
+    int pending; // Subtrees not solved yet, the instance is solved at 0
+    // Subtrees not taken yet: subtrees[subtree_next .. subtree_count), freed once all are taken
+    InputData* subtrees;
+    int subtree_next, subtree_count;
+} PoolInstance;
+
+typedef struct SolvePool {
+    pthread_mutex_t mutex;
+    pthread_cond_t subtree_ready, instance_solved;
+    pthread_t* threads;
+    int thread_count;
+    // Instances with subtrees not taken yet, in submission order. Threads take from them in turn from turn.
+    PoolInstance** queued;
+    int queued_count, queued_capacity;
+    int turn;
+    bool stopping;
+} SolvePool;
+
+// Starts the threads of the pool.
+void pool_init(SolvePool* pool, int threads);
+
+// Waits for the queued subtrees, then stops the threads.
+void pool_free(SolvePool* pool);
+
+// Splits the instance and queues its subtrees. It must stay in place until it's solved.
+// Returns false if its memory limit is too small for even one search (then it's not queued).
+bool pool_submit(SolvePool* pool, PoolInstance* instance);
+
+// Returns whether the instance is solved (its best_solution is final).
+bool pool_solved(SolvePool* pool, const PoolInstance* instance);
+
+// Waits until the instance is solved.
+void pool_wait(SolvePool* pool, const PoolInstance* instance);
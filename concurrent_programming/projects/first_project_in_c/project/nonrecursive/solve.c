@@ -0,0 +1,204 @@
+// The search of the nonrecursive solver. CMake compiles this file once per bucket of sumset words,
+// with SUMSET_WORDS and SOLVE_NONRECURSIVE (the name of the function) defined (see CMakeLists.txt).
+#include <stddef.h>
+#include <stdlib.h>
+#include "common/cache.h"
+#include "common/checkpoint.h"
+#include "common/deadline.h"
+#include "common/io.h"
+#include "common/stats.h"
+#include "common/sumset.h"
+#include "common/sumset_arena.h"
+#include "nonrecursive/solve.h"
+#include "nonrecursive/stack.h"
+
+#ifndef SOLVE_NONRECURSIVE
+#define SOLVE_NONRECURSIVE solve_nonrecursive_generic
+// Functions shared by all the builds are only defined in this one
+#define SOLVE_NONRECURSIVE_GENERIC
+#endif
+
+// The clock is read for checkpoints once per this many iterations
+#define CHECKPOINT_CHECK_MASK ((1 << 16) - 1)
+
+// Writes the frontier: node, which is about to be solved, and the pending children. The pending children
+// of a path node are contiguous on the stack and the last ones of its candidates, so they are written as
+// one range of its children (the candidates in the range that were skipped are skipped again on resume).
+static void checkpoint_stack(Checkpointer* checkpointer, const Stack* stack, const PathNode* node,
+                             const Solution* best_solution) {
+    checkpointer_begin(checkpointer, best_solution);
+    checkpointer_add(checkpointer, node->a, node->b, 0, 0);
+    for (size_t k = 0; k < stack->size;) {
+        int parent = stack->pending[k].parent;
+        int first = stack->pending[k].x, end = first;
+        for (; k < stack->size && stack->pending[k].parent == parent; ++k) {
+            if (stack->pending[k].x < first)
+                first = stack->pending[k].x;
+            if (stack->pending[k].x > end)
+                end = stack->pending[k].x;
+        }
+        const PathNode* father = &stack->path[parent];
+        checkpointer_add(checkpointer, father->small, father->big, first, end);
+    }
+    checkpointer_commit(checkpointer);
+}
+
+void SOLVE_NONRECURSIVE(InputData* input_data, bool bound, int ceiling, SubtreeCache* cache,
+                        Checkpointer* checkpointer, Solution* best_solution) {
+    Stack stack;
+    stack_init(&stack, input_data->d);
+
+    // The root uses the initial sumsets themselves, which solution_build() recognizes
+    PathNode* node = &stack.path[stack.depth++];
+    *node = (PathNode){ .a = &input_data->a_start, .b = &input_data->b_start, .mark = sumset_arena_mark(&stack.arena),
+                        .nodes = 1 };
+    bool trivial = is_sumset_intersection_trivial(&input_data->a_start, &input_data->b_start);
+
+    // The children which are neither trivial nor solutions are only built to add the same sumsets as reference,
+    // SUMSET_SIBLINGS at a time in one pass over their father
+    Sumset* batch[SUMSET_SIBLINGS];
+    int xs[SUMSET_SIBLINGS];
+    Sumset dead_ends[SUMSET_SIBLINGS];
+    for (int k = 0; k < SUMSET_SIBLINGS; ++k)
+        batch[k] = &dead_ends[k];
+
+    bool stopped = false;
+    for (long iteration = 0;; ++iteration) {
+        // Nothing can beat the best solution anymore
+        if (bound && best_solution->sum >= ceiling)
+            break;
+        // The frontier is written as it is now, so that --resume continues from here
+        if (deadline_passed()) {
+            deadline_stop();
+            if (checkpointer != NULL)
+                checkpoint_stack(checkpointer, &stack, node, best_solution);
+            stopped = true;
+            break;
+        }
+        if (checkpointer != NULL && (iteration & CHECKPOINT_CHECK_MASK) == 0 && checkpointer_due(checkpointer))
+            checkpoint_stack(checkpointer, &stack, node, best_solution);
+
+        int top = stack.depth - 1;
+        Sumset* a = node->a;
+        Sumset* b = node->b;
+        if (a->sum > b->sum) {
+            Sumset* temp = a;
+            a = b;
+            b = temp;
+        }
+        node->small = a;
+        node->big = b;
+
+        int cached = -1;
+        // Only near the root, as in parallel (the state is hashed for each lookup)
+        if (cache != NULL && trivial && 2 * a->last <= input_data->d)
+            cached = cache_lookup(cache, a, b);
+
+        if (bound && b->sum > ceiling) {
+            // Treated as a leaf
+        } else if (cached >= 0 && cached <= best_solution->sum) {
+            // A previous run searched the subtree and it can't improve the best solution, treated as a leaf
+            node->best = cached;
+        } else if (trivial) {   // s(a) ∩ s(b) = {0}.
+            node->record = (cache != NULL && cached < 0 && 2 * a->last <= input_data->d);
+            // we change the order in for to have the same
+            // dfs as in reference
+            Word candidates = sumset_missing_mask(b, a->last, input_data->d);
+            int n = 0;
+            while (candidates != 0) {
+                int i = BITS_PER_WORD - 1 - __builtin_clzll(candidates);
+                candidates &= ~((Word)1 << i);
+
+                // Only trivial children and solutions can lead anywhere
+                bool child_trivial = is_shifted_intersection_empty(a, b, i);
+                STAT_ADD(child_trivial ? STAT_TRIVIAL : STAT_NONTRIVIAL, 1);
+                if (child_trivial || (a->sum + i == b->sum && is_shifted_intersection_solution(a, b, i)))
+                    pending_push(&stack, top, i, child_trivial);
+                else if (!bound)
+                    xs[n++] = i;
+
+                if (n == SUMSET_SIBLINGS || candidates == 0) {
+                    sumset_add_siblings(batch, a, xs, n);
+                    n = 0;
+                }
+            }
+        } else if ((a->sum == b->sum) && is_sumset_intersection_solution(a, b)) { // s(a) ∩ s(b) = {0, ∑b}.
+            STAT_ADD(STAT_SOLUTION, 1);
+            if (b->sum > best_solution->sum) {
+                STAT_ADD(STAT_IMPROVEMENT, 1);
+                solution_build(best_solution, input_data, a, b);
+            }
+            node->best = b->sum;
+        }
+
+        // The nodes whose children are all done are popped, up to the father of the next child
+        if (stack.size == 0)
+            break;
+        PendingChild child = stack.pending[--stack.size];
+        while ((int)stack.depth - 1 > child.parent)
+            path_pop(&stack, cache);
+
+        // The child is built only now, from its father which is on the path
+        PathNode* father = &stack.path[child.parent];
+        node = path_push(&stack, father->small->sum + child.x, father->big);
+        sumset_add(node->a, father->small, child.x);
+        trivial = child.trivial;
+    }
+
+    // Also after stopping early, so that no result of an unfinished subtree is recorded
+    if (stopped || (bound && best_solution->sum >= ceiling))
+        stack.depth = 0;
+    while (stack.depth > 0)
+        path_pop(&stack, cache);
+
+    stack_free(&stack);
+}
+
+#ifdef SOLVE_NONRECURSIVE_GENERIC
+size_t solve_nonrecursive_memory(const InputData* input_data) {
+    size_t capacity = input_data->d * input_data->d;
+    int max_sum = input_data->d * input_data->d + input_data->a_start.sum + input_data->b_start.sum;
+    // A path of capacity sumsets with the biggest sum, in whole blocks
+    size_t arena = capacity * sumset_bytes(max_sum);
+    arena = (arena / SUMSET_ARENA_BLOCK_BYTES + 1) * SUMSET_ARENA_BLOCK_BYTES;
+    return (sizeof(PathNode) + sizeof(PendingChild)) * capacity + arena;
+}
+
+int solve_nonrecursive_expand(const InputData* input_data, bool bound, int ceiling, const SolveNode* nodes, int count,
+                              SolveNode* next, Sumset* sumsets, Solution* best_solution) {
+    int d = input_data->d;
+    int next_count = 0;
+    for (int k = 0; k < count; ++k) {
+        SolveNode node = nodes[k];
+        bool a_small = node.a->sum <= node.b->sum;
+        const Sumset* small = a_small ? node.a : node.b;
+        const Sumset* big = a_small ? node.b : node.a;
+        // Treated as a leaf
+        if (bound && big->sum > ceiling)
+            continue;
+        // A solution kept by an earlier level
+        if (best_solution == NULL && !is_sumset_intersection_trivial(small, big)) {
+            next[next_count++] = node;
+            continue;
+        }
+
+        Word candidates = sumset_missing_mask(big, small->last, d);
+        while (candidates != 0) {
+            int x = __builtin_ctzll(candidates);
+            candidates &= candidates - 1;
+            bool trivial = is_shifted_intersection_empty(small, big, x);
+            if (!trivial && !(small->sum + x == big->sum && is_shifted_intersection_solution(small, big, x)))
+                continue;
+
+            // Children in next keep their sumset, the slot of a solution is reused by the next child
+            Sumset* child = &sumsets[next_count];
+            sumset_add(child, small, x);
+            if (trivial || best_solution == NULL)
+                next[next_count++] = a_small ? (SolveNode){ child, big } : (SolveNode){ big, child };
+            else if (big->sum > best_solution->sum)
+                solution_build(best_solution, (InputData*)input_data, child, big);
+        }
+    }
+    return next_count;
+}
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "common/cache.h"
+#include "common/checkpoint.h"
+#include "common/io.h"
+
+// Runs the search of the nonrecursive solver from input_data's A_0, B_0, keeping the best solution in best_solution.
+// With bound, it skips subtrees whose sums are above ceiling and stops once best_solution reaches it.
+// With a cache (only with bound, NULL otherwise), it skips the subtrees recorded there which can't improve
+// best_solution, and records the results of big subtrees.
+// With a checkpointer (NULL otherwise), it writes its frontier to the checkpoint when one is due.
+typedef void (*SolveNonrecursive)(InputData* input_data, bool bound, int ceiling, SubtreeCache* cache,
+    Checkpointer* checkpointer, Solution* best_solution);
+
+// The search compiled for MAX_WORDS words, correct for every input.
+void solve_nonrecursive_generic(InputData* input_data, bool bound, int ceiling, SubtreeCache* cache,
+    Checkpointer* checkpointer, Solution* best_solution);
+
+// Number of sumset words needed for the sums in the search from input_data.
+// Sums stay below d * d when starting from small A_0, B_0, and the sums of A_0 and B_0 are added as margin.
+int solve_nonrecursive_words(const InputData* input_data);
+
+// Returns the search specialized for the fewest words that fit solve_nonrecursive_words(), or the generic one.
+SolveNonrecursive solve_nonrecursive_for(const InputData* input_data);
+
+// Upper bound of the bytes allocated by one search from input_data (its stack and the arena of its path).
+size_t solve_nonrecursive_memory(const InputData* input_data);
+
+// A node of the search, a being built from A_0 and b from B_0 (their chains of prev lead to the start sumsets).
+typedef struct SolveNode {
+    const Sumset *a, *b;
+} SolveNode;
+
+// Expands the nodes of one level of the search breadth-first into next, as the search of nonrecursive would: the
+// children whose intersection stays {0} go to next, in the order of the search, and the solutions among the others
+// update best_solution. With best_solution NULL, the solutions go to next too, in their place in that order,
+// and are then copied to the next levels as they are. next and sumsets (for the new sumsets of a or b) need room
+// for count * d nodes. With bound, nodes above ceiling are leaves. Returns the number of nodes in next.
+int solve_nonrecursive_expand(const InputData* input_data, bool bound, int ceiling, const SolveNode* nodes, int count,
+    SolveNode* next, Sumset* sumsets, Solution* best_solution);
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include "common/cache.h"
+#include "common/sumset.h"
+#include "common/sumset_arena.h"
+
+// The explicit stack of the search of nonrecursive (solve.c), also walked by its sweep (sweep.c).
+// Needs SUMSET_BOUNDED, as the sumsets on the path are in an arena.
+
+// A node on the path from the root to the node being solved. Only these nodes have their sumsets built
+// (in an arena, with the words up to their sums): the children of a node wait as PendingChild records
+// until they reach the top of the stack.
+typedef struct {
+    Sumset* a;
+    Sumset* b;
+    SumsetArenaMark mark; // The arena before a was allocated
+    // The sumsets the children are built from (a is extended, b is shared), ordered so that small->sum <= big->sum
+    Sumset *small, *big;
+    // With a cache: whether the result of the subtree should be recorded when it's popped
+    bool record;
+    // With a cache: the best sum of a solution and the number of nodes in the subtree so far
+    int best;
+    long nodes;
+    // With --sweep: the largest element added on the path from the root (see sweep.c)
+    int max;
+} PathNode;
+
+// A child small + x of the path node parent, not built yet.
+typedef struct {
+    int parent;
+    int x;
+    // s(a) ∩ s(b) = {0}, known from the father's shifted test
+    bool trivial;
+} PendingChild;
+
+typedef struct {
+    PathNode* path;
+    size_t depth;
+    SumsetArena arena;
+    PendingChild* pending;
+    size_t size;
+    size_t capacity;
+} Stack;
+
+static inline void stack_init(Stack* stack, size_t d) {
+    // It can be shown that this size of stack is enough for both the path and the pending children
+    size_t capacity = d * d;
+    stack->path = malloc(sizeof(PathNode) * capacity);
+    stack->pending = malloc(sizeof(PendingChild) * capacity);
+    if (!stack->path || !stack->pending) {
+        exit(1);
+    }
+    sumset_arena_init(&stack->arena, SUMSET_ARENA_BLOCK_BYTES);
+    stack->depth = 0;
+    stack->size = 0;
+    stack->capacity = capacity;
+}
+
+static inline void stack_free(Stack* stack) {
+    free(stack->path);
+    free(stack->pending);
+    sumset_arena_free(&stack->arena);
+}
+
+// Pushes a node on the path, with room for its sumset a with the given sum, filled in by the caller. Returns it.
+static inline PathNode* path_push(Stack* stack, int sum, Sumset* b) {
+    if (stack->depth == stack->capacity) {
+        stack_free(stack);
+        exit(1);
+    }
+    PathNode* node = &stack->path[stack->depth++];
+    node->mark = sumset_arena_mark(&stack->arena);
+    node->a = sumset_arena_alloc(&stack->arena, sum);
+    node->b = b;
+    node->record = false;
+    node->best = 0;
+    node->nodes = 1;
+    node->max = 0;
+    return node;
+}
+
+// Pops the last node of the path, whose subtree is finished. With a cache, records its result if asked to
+// and adds it to the result of the father.
+static inline void path_pop(Stack* stack, SubtreeCache* cache) {
+    PathNode* node = &stack->path[--stack->depth];
+    sumset_arena_release(&stack->arena, node->mark);
+    if (cache == NULL)
+        return;
+
+    if (node->record && node->nodes >= CACHE_MIN_NODES)
+        cache_record(cache, node->small, node->big, node->best);
+    if (stack->depth > 0) {
+        PathNode* father = &stack->path[stack->depth - 1];
+        if (node->best > father->best)
+            father->best = node->best;
+        father->nodes += node->nodes;
+    }
+}
+
+static inline void pending_push(Stack* stack, int parent, int x, bool trivial) {
+    if (stack->size == stack->capacity) {
+        stack_free(stack);
+        exit(1);
+    }
+    stack->pending[stack->size++] = (PendingChild){ parent, x, trivial };
+}
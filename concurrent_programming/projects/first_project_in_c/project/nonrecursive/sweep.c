@@ -0,0 +1,137 @@
+#include "nonrecursive/sweep.h"
+
+#include "common/bound.h"
+#include "common/stats.h"
+#include "common/sumset.h"
+#include "nonrecursive/stack.h"
+
+typedef struct {
+    InputData* input_data;
+    bool bound;
+    int first, last; // The d of the sweep
+    int open; // With bound: the biggest d whose best solution is below its ceiling, first - 1 if there is none
+    int ceilings[MAX_D + 1];
+    Solution* best_solutions;
+} Sweep;
+
+int sweep_first_d(const InputData* input_data)
+{
+    int first = 3;
+    for (int x = 1; x <= MAX_D; ++x) {
+        if ((input_data->a_in.count[x] > 0 || input_data->b_in.count[x] > 0) && x > first)
+            first = x;
+    }
+    return first;
+}
+
+// Recomputes sweep->open after a best solution changed.
+static void update_open(Sweep* sweep)
+{
+    while (sweep->open >= sweep->first && sweep->best_solutions[sweep->open].sum >= sweep->ceilings[sweep->open])
+        sweep->open--;
+}
+
+// The leaf (a, b), whose largest added element is max, is a solution for every d >= max.
+static void solution_found(Sweep* sweep, const Sumset* a, const Sumset* b, int max)
+{
+    STAT_ADD(STAT_SOLUTION, 1);
+    int sum = (a->sum > b->sum) ? a->sum : b->sum;
+    bool built = false;
+    Solution solution;
+    for (int d = (max > sweep->first) ? max : sweep->first; d <= sweep->last; ++d) {
+        if (sum <= sweep->best_solutions[d].sum)
+            continue;
+        STAT_ADD(STAT_IMPROVEMENT, 1);
+        if (!built) {
+            solution_build(&solution, sweep->input_data, a, b);
+            built = true;
+        }
+        sweep->best_solutions[d] = solution;
+    }
+    if (sweep->bound && built)
+        update_open(sweep);
+}
+
+// Searches the tree of D on the explicit stack of the search of nonrecursive (see stack.h), in the same order.
+// Each path node has the largest element added on its path. Unlike the search, the children which are neither
+// trivial nor solutions are not built.
+static void sweep_search(Sweep* sweep)
+{
+    InputData* input_data = sweep->input_data;
+    Stack stack;
+    stack_init(&stack, input_data->d);
+
+    // The root uses the initial sumsets themselves, which solution_build() recognizes
+    PathNode* node = &stack.path[stack.depth++];
+    *node = (PathNode){ .a = &input_data->a_start, .b = &input_data->b_start, .mark = sumset_arena_mark(&stack.arena),
+                        .nodes = 1 };
+    bool trivial = is_sumset_intersection_trivial(&input_data->a_start, &input_data->b_start);
+
+    // With bound, every d reached its ceiling
+    while (!(sweep->bound && sweep->open < sweep->first)) {
+        int top = stack.depth - 1;
+        Sumset* a = node->a;
+        Sumset* b = node->b;
+        if (a->sum > b->sum) {
+            Sumset* temp = a;
+            a = b;
+            b = temp;
+        }
+        node->small = a;
+        node->big = b;
+
+        if (trivial) {
+            // With bound, treated as a leaf if nothing in the subtree can improve a d that isn't solved yet
+            bool leaf = sweep->bound && (node->max > sweep->open || b->sum > sweep->ceilings[sweep->open]);
+            // The children are pushed in decreasing order so that they are solved in increasing order, as in
+            // reference, and only up to the last d that can use them
+            int last = sweep->bound ? sweep->open : sweep->last;
+            Word candidates = leaf ? 0 : sumset_missing_mask(b, a->last, last);
+            while (candidates != 0) {
+                int x = BITS_PER_WORD - 1 - __builtin_clzll(candidates);
+                candidates &= ~((Word)1 << x);
+                bool child_trivial = is_shifted_intersection_empty(a, b, x);
+                STAT_ADD(child_trivial ? STAT_TRIVIAL : STAT_NONTRIVIAL, 1);
+                if (child_trivial || (a->sum + x == b->sum && is_shifted_intersection_solution(a, b, x)))
+                    pending_push(&stack, top, x, child_trivial);
+            }
+        } else if (a->sum == b->sum && is_sumset_intersection_solution(a, b)) {
+            solution_found(sweep, a, b, node->max);
+        }
+
+        // The nodes whose children are all done are popped, up to the father of the next child
+        if (stack.size == 0)
+            break;
+        PendingChild child = stack.pending[--stack.size];
+        while ((int)stack.depth - 1 > child.parent)
+            path_pop(&stack, NULL);
+
+        // The child is built only now, from its father which is on the path
+        PathNode* father = &stack.path[child.parent];
+        node = path_push(&stack, father->small->sum + child.x, father->big);
+        sumset_add(node->a, father->small, child.x);
+        node->max = (child.x > father->max) ? child.x : father->max;
+        trivial = child.trivial;
+    }
+    stack_free(&stack);
+}
+
+void sweep_run(InputData* input_data, bool bound, Solution best_solutions[MAX_D + 1])
+{
+    Sweep sweep = { .input_data = input_data, .bound = bound, .first = sweep_first_d(input_data),
+                    .last = input_data->d, .best_solutions = best_solutions };
+    for (int d = sweep.first; d <= sweep.last; ++d) {
+        solution_init(&best_solutions[d]);
+        if (bound) {
+            // The input with this d
+            InputData input_d = *input_data;
+            input_d.d = d;
+            sweep.ceilings[d] = alpha_ceiling(&input_d);
+            solution_seed(&best_solutions[d], &input_d);
+        }
+    }
+    sweep.open = sweep.last;
+    if (bound)
+        update_open(&sweep);
+    sweep_search(&sweep);
+}
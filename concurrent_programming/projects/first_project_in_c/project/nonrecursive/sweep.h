@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdbool.h>
+#include "common/io.h"
+
+// Sweep mode of nonrecursive (--sweep): with the d of the input as D, computes α(d, A_0, B_0) for every d from
+// sweep_first_d() to D in one search of the tree of D.
+//
+// The tree of d is the subtree of the tree of D whose nodes only add elements up to d, visited in the same order.
+// A leaf whose largest added element is m is a solution for every d >= m, so it updates the best solutions of all
+// of them: each is the first best one in the order of reference, as in a search of its own.
+// With bound, subtrees above the ceiling of the biggest d not solved yet (the search stops when there is none)
+// and children above that d are skipped, and each d starts from the solution of solution_seed().
+
+// The smallest d of the sweep: the largest element of A_0 and B_0, and at least 3.
+int sweep_first_d(const InputData* input_data);
+
+// Sets best_solutions[d] for every d from sweep_first_d() to input_data->d.
+void sweep_run(InputData* input_data, bool bound, Solution best_solutions[MAX_D + 1]);
@@ -0,0 +1,76 @@
+#include "parallel/batch.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common/io.h"
+#include "nonrecursive/pool.h"
+
+// Reads the next instance, returns false at the end of the input.
+static bool read_instance(InputData* input_data)
+{
+    int c;
+    while ((c = getchar()) != EOF && isspace(c))
+        ;
+    if (c == EOF)
+        return false;
+    ungetc(c, stdin);
+    // input_data_read() doesn't clear the count of MAX_D
+    memset(input_data, 0, sizeof(*input_data));
+    input_data_read(input_data);
+    return true;
+}
+
+// Prints the solved instances at the front of the input order, all of them with wait. Printed ones are freed.
+static void print_solved(SolvePool* pool, PoolInstance** instances, int count, int* printed, bool wait)
+{
+    for (; *printed < count; ++*printed) {
+        PoolInstance* instance = instances[*printed];
+        if (wait)
+            pool_wait(pool, instance);
+        else if (!pool_solved(pool, instance))
+            break;
+        solution_print(&instance->best_solution);
+        free(instance);
+        instances[*printed] = NULL;
+    }
+    fflush(stdout);
+}
+
+void batch_run(bool bound)
+{
+    SolvePool pool;
+    bool started = false;
+    // Pointers, the instances stay in place when the array grows
+    PoolInstance** instances = NULL;
+    int count = 0, capacity = 0, printed = 0;
+    InputData input_data;
+    while (read_instance(&input_data)) {
+        if (!started) {
+            pool_init(&pool, (input_data.t > 0) ? input_data.t : 1);
+            started = true;
+        }
+
+        PoolInstance* instance = malloc(sizeof(PoolInstance));
+        if (instance == NULL)
+            exit(1);
+        *instance = (PoolInstance){ .input_data = input_data, .bound = bound };
+        if (count == capacity) {
+            capacity = (capacity == 0) ? 256 : 2 * capacity;
+            instances = realloc(instances, sizeof(PoolInstance*) * capacity);
+            if (instances == NULL)
+                exit(1);
+        }
+        instances[count++] = instance;
+        // Without a memory limit, always queued
+        pool_submit(&pool, instance);
+        print_solved(&pool, instances, count, &printed, false);
+    }
+
+    if (started) {
+        print_solved(&pool, instances, count, &printed, true);
+        pool_free(&pool);
+    }
+    free(instances);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdbool.h>
+
+// Batch mode of parallel (--batch): reads instances (t, d, n, m, A_0, B_0, as in the input of one search) from stdin
+// until its end and prints their solutions in input order. One pool of t threads (t of the first instance, see
+// nonrecursive/pool.h) solves the instances of the whole stream.
+// With bound, as in the other solvers: subtrees above the ceiling of their instance are skipped.
+void batch_run(bool bound);
@@ -0,0 +1,374 @@
+// Runs reference, nonrecursive and parallel on `t d 0 1 / 1` for each d and number of threads t (the table of the
+// report), and writes the median wall time, speedup, efficiency and peak RSS of each to CSV and JSON.
+// Usage: bench_scalability [--d LIST] [--threads LIST] [--repeats N] [--timeout SECONDS] [--csv PATH] [--json PATH]
+//                          REFERENCE NONRECURSIVE PARALLEL
+// LISTs are separated by commas. A run longer than the timeout is killed: its configuration isn't repeated, gets -1
+// for the time, speedup and efficiency, and is skipped (also -1, with 0 runs) for the bigger d.
+// The speedup of parallel is relative to its time with 1 thread at the same d, vs_reference to the time of reference.
+// The files are rewritten after each d, so an interrupted benchmark keeps the results so far.
+#define _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "common/err.h"
+
+#ifndef BENCH_BUILD_TYPE
+#define BENCH_BUILD_TYPE ""
+#endif
+
+#define MAX_VALUES 64
+#define MAX_REPEATS 100
+
+enum { REFERENCE, NONRECURSIVE, PARALLEL, SOLVERS };
+static const char* solver_names[SOLVERS] = { "reference", "nonrecursive", "parallel" };
+
+typedef struct {
+    int solver;
+    int d;
+    int threads;
+    int runs;
+    double median_ms; // -1 after a timeout
+    double speedup;
+    double efficiency;
+    double vs_reference;
+    long peak_rss_kib; // The biggest of the runs
+    int sum; // The first line of the output, the same for all solvers (-1 if unknown)
+} Result;
+
+typedef struct {
+    int d[MAX_VALUES];
+    int d_count;
+    int threads[MAX_VALUES];
+    int threads_count;
+    int repeats;
+    int timeout;
+    const char* csv_path;
+    const char* json_path;
+    const char* paths[SOLVERS];
+} Config;
+
+static int parse_list(const char* text, int* values, const char* name)
+{
+    int count = 0;
+    const char* p = text;
+    while (true) {
+        char* end;
+        long value = strtol(p, &end, 10);
+        if (end == p || value < 1 || count == MAX_VALUES)
+            fatal("Bad %s list: %s", name, text);
+        values[count++] = value;
+        if (*end == '\0')
+            return count;
+        if (*end != ',')
+            fatal("Bad %s list: %s", name, text);
+        p = end + 1;
+    }
+}
+
+static int parse_number(const char* text, const char* name)
+{
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || value < 1)
+        fatal("%s needs a positive number", name);
+    return value;
+}
+
+static void config_parse(Config* config, int argc, char* argv[])
+{
+    config->d_count = parse_list("5,10,15,20,25,30,32,34", config->d, "--d");
+    config->threads_count = parse_list("1,2,4,8,16,32,64", config->threads, "--threads");
+    config->repeats = 3;
+    config->timeout = 60;
+    config->csv_path = NULL;
+    config->json_path = NULL;
+    int solvers = 0;
+    for (int i = 1; i < argc; i++) {
+        const char* option = argv[i];
+        bool has_value = (option[0] == '-' && i + 1 < argc);
+        if (strcmp(option, "--d") == 0 && has_value)
+            config->d_count = parse_list(argv[++i], config->d, option);
+        else if (strcmp(option, "--threads") == 0 && has_value)
+            config->threads_count = parse_list(argv[++i], config->threads, option);
+        else if (strcmp(option, "--repeats") == 0 && has_value)
+            config->repeats = parse_number(argv[++i], option);
+        else if (strcmp(option, "--timeout") == 0 && has_value)
+            config->timeout = parse_number(argv[++i], option);
+        else if (strcmp(option, "--csv") == 0 && has_value)
+            config->csv_path = argv[++i];
+        else if (strcmp(option, "--json") == 0 && has_value)
+            config->json_path = argv[++i];
+        else if (option[0] != '-' && solvers < SOLVERS)
+            config->paths[solvers++] = option;
+        else
+            solvers = SOLVERS + 1;
+    }
+    if (solvers != SOLVERS || config->repeats > MAX_REPEATS)
+        fatal("Usage: %s [--d LIST] [--threads LIST] [--repeats N<=%d] [--timeout SECONDS] [--csv PATH] [--json PATH] "
+              "REFERENCE NONRECURSIVE PARALLEL", argv[0], MAX_REPEATS);
+    for (int k = 0; k < config->d_count; ++k)
+        if (config->d[k] < 3 || config->d[k] > 50)
+            fatal("d must be in 3..50");
+    for (int k = 0; k < config->threads_count; ++k)
+        if (config->threads[k] > 64)
+            fatal("The number of threads must be in 1..64");
+}
+
+static double elapsed_ms(const struct timespec* start, const struct timespec* end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e3 + (end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+// Runs a solver once on `threads d 0 1 / 1`, with SIGCHLD blocked by the caller.
+// Returns the wall time in ms, or -1 if the solver was killed after timeout seconds.
+static double run_once(const char* path, int threads, int d, int timeout, long* rss_kib, int* sum)
+{
+    char input[64];
+    int length = snprintf(input, sizeof(input), "%d %d 0 1\n\n1\n", threads, d);
+    // The input fits in the buffer of the pipe, so it's written before the solver starts
+    int input_pipe[2];
+    ASSERT_SYS_OK(pipe(input_pipe));
+    if (write(input_pipe[1], input, length) != length)
+        syserr("Cannot write the input");
+    ASSERT_SYS_OK(close(input_pipe[1]));
+    FILE* output = tmpfile();
+    if (output == NULL)
+        syserr("Cannot create a temporary file");
+
+    sigset_t children;
+    sigemptyset(&children);
+    sigaddset(&children, SIGCHLD);
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = fork();
+    ASSERT_SYS_OK(pid);
+    if (pid == 0) {
+        ASSERT_SYS_OK(sigprocmask(SIG_UNBLOCK, &children, NULL));
+        ASSERT_SYS_OK(dup2(input_pipe[0], STDIN_FILENO));
+        ASSERT_SYS_OK(dup2(fileno(output), STDOUT_FILENO));
+        execl(path, path, (char*)NULL);
+        syserr("Cannot run %s", path);
+    }
+    ASSERT_SYS_OK(close(input_pipe[0]));
+
+    // Waits for the exit of the solver (SIGCHLD) until the deadline, then kills it
+    int status;
+    struct rusage usage;
+    bool killed = false;
+    while (true) {
+        pid_t done = wait4(pid, &status, WNOHANG, &usage);
+        ASSERT_SYS_OK(done);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (done == pid)
+            break;
+        double left_ms = timeout * 1e3 - elapsed_ms(&start, &now);
+        if (left_ms <= 0) {
+            ASSERT_SYS_OK(kill(pid, SIGKILL));
+            ASSERT_SYS_OK(wait4(pid, &status, 0, &usage));
+            killed = true;
+            break;
+        }
+        struct timespec left = { (time_t)(left_ms / 1e3), (long)(left_ms * 1e6) % 1000000000 };
+        if (sigtimedwait(&children, NULL, &left) == -1 && errno != EAGAIN && errno != EINTR)
+            syserr("sigtimedwait");
+    }
+    *rss_kib = usage.ru_maxrss;
+
+    if (!killed && (!WIFEXITED(status) || WEXITSTATUS(status) != 0))
+        fatal("%s failed on `%d %d 0 1 / 1`", path, threads, d);
+    *sum = -1;
+    rewind(output);
+    if (!killed && fscanf(output, "%d", sum) != 1)
+        fatal("%s printed no solution for `%d %d 0 1 / 1`", path, threads, d);
+    fclose(output);
+    return killed ? -1 : elapsed_ms(&start, &now);
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Fills in the time, peak RSS and sum of result, unless skip (a smaller d timed out).
+static void measure(const Config* config, Result* result, int solver, int d, int threads, bool skip)
+{
+    *result = (Result){ .solver = solver, .d = d, .threads = threads, .median_ms = -1, .speedup = -1,
+                        .efficiency = -1, .vs_reference = -1, .peak_rss_kib = 0, .sum = -1 };
+    if (skip)
+        return;
+
+    double times[MAX_REPEATS];
+    for (int r = 0; r < config->repeats; ++r) {
+        long rss_kib;
+        times[r] = run_once(config->paths[solver], threads, d, config->timeout, &rss_kib, &result->sum);
+        result->runs++;
+        if (rss_kib > result->peak_rss_kib)
+            result->peak_rss_kib = rss_kib;
+        if (times[r] < 0)
+            break;
+    }
+    if (times[result->runs - 1] >= 0) {
+        qsort(times, result->runs, sizeof(double), compare_doubles);
+        result->median_ms = (result->runs % 2 == 1) ? times[result->runs / 2]
+                                                     : (times[result->runs / 2 - 1] + times[result->runs / 2]) / 2;
+    }
+    fprintf(stderr, "%-12s d=%-2d threads=%-2d %10.1f ms %8ld KiB\n", solver_names[solver], d, threads,
+            result->median_ms, result->peak_rss_kib);
+}
+
+static double ratio(double base_ms, double ms)
+{
+    return (base_ms < 0 || ms <= 0) ? -1 : base_ms / ms;
+}
+
+// Computes the speedups of the results of one d, results[0] being reference.
+static void compute_speedups(Result* results, int count)
+{
+    double reference_ms = results[0].median_ms;
+    double single_ms = -1;
+    for (int k = 0; k < count; ++k)
+        if (results[k].solver == PARALLEL && results[k].threads == 1)
+            single_ms = results[k].median_ms;
+
+    for (int k = 0; k < count; ++k) {
+        Result* result = &results[k];
+        if (result->median_ms < 0)
+            continue;
+        if (result->solver == PARALLEL) {
+            result->speedup = ratio(single_ms, result->median_ms);
+            if (result->speedup >= 0)
+                result->efficiency = result->speedup / result->threads;
+        } else {
+            result->speedup = 1;
+            result->efficiency = 1;
+        }
+        result->vs_reference = ratio(reference_ms, result->median_ms);
+        if (results[0].sum >= 0 && result->sum != results[0].sum)
+            fatal("d=%d: %s with %d threads found %d instead of %d", result->d, solver_names[result->solver],
+                  result->threads, result->sum, results[0].sum);
+    }
+}
+
+static void write_csv(const char* path, const Result* results, int count)
+{
+    FILE* file = fopen(path, "w");
+    if (file == NULL)
+        syserr("Cannot create %s", path);
+    fprintf(file, "solver,d,threads,runs,median_ms,speedup,efficiency,vs_reference,peak_rss_kib,sum\n");
+    for (int k = 0; k < count; ++k) {
+        const Result* r = &results[k];
+        fprintf(file, "%s,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%ld,%d\n", solver_names[r->solver], r->d, r->threads, r->runs,
+                r->median_ms, r->speedup, r->efficiency, r->vs_reference, r->peak_rss_kib, r->sum);
+    }
+    if (fclose(file) != 0)
+        syserr("Cannot write %s", path);
+}
+
+// The model of the CPU, to compare the results of different machines
+static void cpu_model(char* model, size_t size)
+{
+    snprintf(model, size, "unknown");
+    FILE* file = fopen("/proc/cpuinfo", "r");
+    if (file == NULL)
+        return;
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char* colon = strchr(line, ':');
+        if (strncmp(line, "model name", 10) == 0 && colon != NULL) {
+            colon += strspn(colon + 1, " \t") + 1;
+            colon[strcspn(colon, "\n")] = '\0';
+            snprintf(model, size, "%s", colon);
+            break;
+        }
+    }
+    fclose(file);
+}
+
+static void write_json(const char* path, const Config* config, const Result* results, int count)
+{
+    FILE* file = fopen(path, "w");
+    if (file == NULL)
+        syserr("Cannot create %s", path);
+
+    struct utsname system;
+    ASSERT_SYS_OK(uname(&system));
+    char model[128];
+    cpu_model(model, sizeof(model));
+    for (char* c = model; *c != '\0'; ++c)
+        if (*c == '"' || *c == '\\')
+            *c = ' ';
+    char date[32];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    fprintf(file, "{\n  \"date\": \"%s\",\n", date);
+    fprintf(file, "  \"machine\": {\"cpu\": \"%s\", \"cpus\": %ld, \"system\": \"%s %s %s\"},\n", model,
+            sysconf(_SC_NPROCESSORS_ONLN), system.sysname, system.release, system.machine);
+    fprintf(file, "  \"build\": {\"type\": \"%s\", \"compiler\": \"%s\"},\n", BENCH_BUILD_TYPE, __VERSION__);
+    fprintf(file, "  \"repeats\": %d,\n  \"timeout_s\": %d,\n  \"results\": [\n", config->repeats, config->timeout);
+    for (int k = 0; k < count; ++k) {
+        const Result* r = &results[k];
+        fprintf(file,
+                "    {\"solver\": \"%s\", \"d\": %d, \"threads\": %d, \"runs\": %d, \"median_ms\": %.3f, "
+                "\"speedup\": %.3f, \"efficiency\": %.3f, \"vs_reference\": %.3f, \"peak_rss_kib\": %ld, "
+                "\"sum\": %d}%s\n",
+                solver_names[r->solver], r->d, r->threads, r->runs, r->median_ms, r->speedup, r->efficiency,
+                r->vs_reference, r->peak_rss_kib, r->sum, (k + 1 < count) ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    if (fclose(file) != 0)
+        syserr("Cannot write %s", path);
+}
+
+int main(int argc, char* argv[])
+{
+    Config config;
+    config_parse(&config, argc, argv);
+
+    // SIGCHLD stays pending until run_once() waits for it
+    sigset_t children;
+    sigemptyset(&children);
+    sigaddset(&children, SIGCHLD);
+    ASSERT_SYS_OK(sigprocmask(SIG_BLOCK, &children, NULL));
+
+    int per_d = 2 + config.threads_count;
+    Result* results = malloc(sizeof(Result) * config.d_count * per_d);
+    if (results == NULL)
+        exit(1);
+    // The smallest d that timed out (0 if none), for reference, nonrecursive and parallel with each number of threads
+    int timeout_d[2 + MAX_VALUES] = { 0 };
+
+    int count = 0;
+    for (int i = 0; i < config.d_count; ++i) {
+        int d = config.d[i];
+        Result* row = &results[count];
+        for (int k = 0; k < per_d; ++k) {
+            int solver = (k < PARALLEL) ? k : PARALLEL;
+            int threads = (k < PARALLEL) ? 1 : config.threads[k - PARALLEL];
+            measure(&config, &row[k], solver, d, threads, timeout_d[k] != 0 && timeout_d[k] < d);
+            if (row[k].runs > 0 && row[k].median_ms < 0 && (timeout_d[k] == 0 || d < timeout_d[k]))
+                timeout_d[k] = d;
+        }
+        compute_speedups(row, per_d);
+        count += per_d;
+
+        if (config.csv_path != NULL)
+            write_csv(config.csv_path, results, count);
+        if (config.json_path != NULL)
+            write_json(config.json_path, &config, results, count);
+    }
+    if (config.csv_path == NULL)
+        write_csv("/dev/stdout", results, count);
+
+    free(results);
+    return 0;
+}
@@ -1,193 +1,989 @@
+#include <limits.h>
 #include <stddef.h>
 #include <pthread.h>
+#include <sched.h>
+#include <stdalign.h>
 #include <stdatomic.h>
 #include <malloc.h>
+#include <math.h>
 #include <stdlib.h>
-#include <semaphore.h>
+#include "common/bound.h"
+#include "common/cache.h"
+#include "common/checkpoint.h"
+#include "common/deadline.h"
+#include "common/err.h"
 #include "common/io.h"
+#include "common/options.h"
+#include "common/progress.h"
+#include "common/stats.h"
+#include "common/transposition.h"
 #include "common/sumset.h"
+#include "common/sumset_arena.h"
+#include "parallel/batch.h"
 
 typedef struct {
     // The tasks are pointers to the parents and i for which I create a new sumset
     const Sumset *a, *b;
     int i;
+    double size; // Estimated number of nodes in the subtree of the task
 } Task;
 
+// A loop over the children a + i, next <= i <= end, of a node with s(a) ∩ s(b) = {0}.
+// It lives on the stack of the thread running it, the upper half of its remaining
+// children can be given to another thread, except those up to built (already built by us in a batch).
+typedef struct {
+    const Sumset *a, *b;
+    int next, end;
+    int built;
+    int current; // The child being solved, the later ones are not started (for checkpoints)
+} Frame;
+
+// Maximal number of frames in a deque, bigger than the recursion depth
+// (every recursion level adds at least 1 to one of two sums smaller than MAX_BITS).
+#define DEQUE_SIZE (2 * MAX_BITS)
+
+// The owner pushes and pops its frames at the bottom, the oldest frames (at the top)
+// are split when another thread asks for work. Only the owner accesses it,
+// so there are no atomic operations in the hot loop.
+typedef struct {
+    Frame* frames[DEQUE_SIZE];
+    int top, bottom;
+} Deque;
+
+#define NO_REQUEST (-1)
+#define CLOSED (-2) // The thread has finished and doesn't accept requests
+#define PAUSE (-3) // The main thread asks us to wait while it writes a checkpoint
+
+enum { WAITING, REJECTED, ACCEPTED };
+
+// Data of each thread
+typedef struct {
+    alignas(64) atomic_int request; // Id of the thread asking us for work, NO_REQUEST, CLOSED or PAUSE
+    alignas(64) atomic_int response; // Answer to our own request
+    Frame stolen; // Work given to us with ACCEPTED (a and b point into chain)
+    SumsetArena chain; // Storage for the sumsets copied when receiving work
+    SumsetArena arena; // The children built by our frames
+    Deque deque;
+    const Sumset *paused_a, *paused_b; // While paused: the node about to be solved, NULL if none
+    // Only written by the thread, and read by the progress reporter (relaxed, see add_relaxed())
+    atomic_long nodes; // Number of trivial nodes visited, for the sizes of subtrees
+    atomic_long task_weight; // Sum of task_weight() of the tasks finished
+    Solution local_solution;
+    unsigned seed; // For choosing victims of stealing
+    int id;
+} ThreadData;
+
 static InputData input_data;
+static Options options;
 static Solution best_solution;
 
-// Array of tasks and sumsets
-static Sumset* tab_sumset = NULL;
+// With --bound: no solution has a bigger sum than ceiling, and incumbent is the best sum found by any thread
+static int ceiling;
+static atomic_int incumbent;
+// With --bound: states already visited by some thread
+static TranspositionTable table;
+// The table takes at most this much of the memory of each thread
+#define TABLE_MIB_PER_THREAD 64
+// With --cache: results of subtrees from previous runs, and of this one for the next runs
+static SubtreeCache cache;
+
+// The result of the search of a subtree is the best sum of a solution in it (0 if none), or INCOMPLETE
+// if it wasn't searched completely. INCOMPLETE is bigger than any sum, so the maximum over children keeps it.
+#define INCOMPLETE INT_MAX
+
+// Array of tasks, and the sumsets they point to
+static SumsetArena tab_sumset;
 static Task* tab_tasks = NULL;
+static size_t tab_sumset_size; // Maximal number of sumsets built for the tasks
 
-static int s = 0; // Index of the last sumset
-static atomic_int zz; // Number of available tasks
+static int s = 0; // Number of sumsets built for the tasks
 static int z = 0; // Index of the last task (only for adding tasks)
 
-// Unlocks the threads that are processing tasks
-static sem_t main_semaphore;
+// Max-heap of the frontier tasks by size, used by the main solver thread to expand the biggest ones
+static Task* heap = NULL;
+static int heap_size = 0;
+
+// The sumsets built by the recursion are in the arenas, so a level of it takes less than 512 bytes of the stack
+// (solve_trivial() and solve_children()), instead of the default 8 MiB for the whole stack
+#define THREAD_STACK_BYTES (DEQUE_SIZE * 512 + (256 << 10))
+
+// Number of random paths walked by estimate_subtree()
+#define PROBES 4
+
+// Tasks are split until they are smaller than 1 / SPLIT_FACTOR of a thread's share of the tree...
+#define SPLIT_FACTOR 8
+// ...but smaller subtrees are left for work stealing
+#define MIN_SPLIT_SIZE 16384.0
+
+// The tasks are taken while the main solver thread is still generating them
+static atomic_int published; // Number of tasks ready to be taken
+static atomic_int taken; // Number of tasks already taken
+static atomic_bool frontier_done; // Set when no more tasks will be published
+
+static ThreadData* all_thread_data = NULL;
+static int thread_count;
+
+// With --checkpoint: the main thread pauses the searching threads to write their frontiers
+static Checkpointer checkpointer;
+static pthread_mutex_t pause_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pause_cond; // Signaled when paused or finished changes, or the checkpoint is written
+static int paused; // Number of threads waiting in wait_for_checkpoint()
+static bool writing; // Whether the main thread is writing a checkpoint
+static int finished; // Number of threads that returned
+// With --resume: the checkpoint whose frames are the tasks
+static Checkpoint resumed;
+
+// Number of threads which have work (tasks or a part of a frame), the search ends when it drops to 0
+static atomic_int active;
+
+// Adds n to a counter only the calling thread writes: a plain load and store, so it's as cheap as a non-atomic one.
+static inline void add_relaxed(atomic_long* counter, long n)
+{
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
 
-// Recursion level with tasks
-static int task_level = 3;
+// The share of a task in the estimate of the whole search: its estimated size (at least 1).
+static inline long task_weight(const Task* task)
+{
+    return (task->size >= 1) ? (long)task->size : 1;
+}
 
-// Solution of each thread
-typedef struct {
-    Solution local_solution;
-} ThreadData;
+// Copies s and all its ancestors except the initial sumset into storage, keeping prev pointers consistent.
+// Returns the copy of s.
+static const Sumset* copy_chain(SumsetArena* storage, const Sumset* s)
+{
+    const Sumset* result = s;
+    Sumset* last_copy = NULL;
+    while (s->prev != NULL) {
+        Sumset* copy = sumset_arena_copy(storage, s);
+        if (last_copy != NULL)
+            last_copy->prev = copy;
+        else
+            result = copy;
+        last_copy = copy;
+        s = s->prev;
+    }
+    if (last_copy != NULL)
+        last_copy->prev = s;
+    return result;
+}
+
+// Gives the upper half of the remaining children of our oldest frame to the thread asking for work
+// (or rejects the request if we have nothing to give).
+static void answer_request(ThreadData* thread_data)
+{
+    ThreadData* thief = &all_thread_data[atomic_load_explicit(&thread_data->request, memory_order_relaxed)];
+    Deque* deque = &thread_data->deque;
+    int response = REJECTED;
+
+    while (deque->top < deque->bottom) {
+        Frame* frame = deque->frames[deque->top];
+        int first = (frame->next > frame->built) ? frame->next : frame->built + 1;
+        int count = frame->end - first + 1;
+        if (count <= 0) {
+            deque->top++;
+            continue;
+        }
+
+        int mid = first + count / 2;
+        // The thief is waiting for the response, its previous work is finished
+        sumset_arena_clear(&thief->chain);
+        thief->stolen.a = copy_chain(&thief->chain, frame->a);
+        thief->stolen.b = copy_chain(&thief->chain, frame->b);
+        thief->stolen.next = mid;
+        thief->stolen.end = frame->end;
+        frame->end = mid - 1;
+
+        // We are still active, so active can't drop to 0 in the meantime
+        atomic_fetch_add(&active, 1);
+        response = ACCEPTED;
+        break;
+    }
+
+    atomic_store_explicit(&thread_data->request, NO_REQUEST, memory_order_relaxed);
+    atomic_store_explicit(&thief->response, response, memory_order_release);
+}
+
+// Waits while the main thread writes a checkpoint, with (a, b) as the node we are about to solve.
+static void wait_for_checkpoint(ThreadData* thread_data, const Sumset* a, const Sumset* b)
+{
+    thread_data->paused_a = a;
+    thread_data->paused_b = b;
+    ASSERT_ZERO(pthread_mutex_lock(&pause_mutex));
+    paused++;
+    ASSERT_ZERO(pthread_cond_broadcast(&pause_cond));
+    while (writing)
+        ASSERT_ZERO(pthread_cond_wait(&pause_cond, &pause_mutex));
+    paused--;
+    ASSERT_ZERO(pthread_cond_broadcast(&pause_cond));
+    ASSERT_ZERO(pthread_mutex_unlock(&pause_mutex));
+}
+
+static void handle_request(ThreadData* thread_data, const Sumset* a, const Sumset* b)
+{
+    if (atomic_load_explicit(&thread_data->request, memory_order_relaxed) == PAUSE)
+        wait_for_checkpoint(thread_data, a, b);
+    else
+        answer_request(thread_data);
+}
+
+// Answers a request for work, or pauses for a checkpoint. (a, b) is the node we are about to solve, NULL if none.
+static inline void poll_request(ThreadData* thread_data, const Sumset* a, const Sumset* b)
+{
+    if (atomic_load_explicit(&thread_data->request, memory_order_relaxed) != NO_REQUEST)
+        handle_request(thread_data, a, b);
+}
+
+// With --bound: whether the subtree of (a, b), a->sum <= b->sum, can't contain a better solution.
+// All sums in it are at least b->sum, and none is better than ceiling.
+// Also true for every subtree once --deadline-ms passed, the whole search is stopping then.
+static inline bool can_prune(const Sumset* b)
+{
+    if (deadline_passed()) {
+        deadline_stop();
+        return true;
+    }
+    return options.bound && (b->sum > ceiling || atomic_load_explicit(&incumbent, memory_order_relaxed) >= ceiling);
+}
+
+// Updates solution with the leaf (a, b) if it's better, publishing its sum with --bound.
+static void update_solution(Solution* solution, const Sumset* a, const Sumset* b)
+{
+    STAT_ADD(STAT_SOLUTION, 1);
+    if (b->sum > solution->sum) {
+        STAT_ADD(STAT_IMPROVEMENT, 1);
+        solution_build(solution, &input_data, a, b);
+        if (options.bound) {
+            int best = atomic_load(&incumbent);
+            while (best < b->sum && !atomic_compare_exchange_weak(&incumbent, &best, b->sum))
+                ;
+        }
+    }
+}
+
+static int solve_trivial(const Sumset* a, const Sumset* b, ThreadData* thread_data);
+
+// Goes through the children a + i, first <= i <= end.
+// Each child is classified from the parent with a shifted test before it's built, and with --bound
+// the children which are neither trivial nor a solution are not built at all.
+// The others are built in batches of up to SUMSET_SIBLINGS (see sumset_add_siblings()).
+// The result is incomplete if some of the children were given to another thread.
+static int solve_children(const Sumset* a, const Sumset* b, int first, int end, ThreadData* thread_data)
+{
+    int best = 0;
+    Frame frame = { a, b, first, end, 0, first - 1 };
+    Deque* deque = &thread_data->deque;
+    deque->frames[deque->bottom++] = &frame;
+    Word candidates = sumset_missing_mask(b, first, end);
+
+    // The children of a batch are allocated in the arena of the thread, and released after the batch
+    SumsetArena* arena = &thread_data->arena;
+    Sumset* children[SUMSET_SIBLINGS];
+    int xs[SUMSET_SIBLINGS];
+    bool trivial[SUMSET_SIBLINGS];
+    bool leaf[SUMSET_SIBLINGS]; // A solution
+
+    // frame.end can be decreased by answer_request() in the recursive calls, but not below frame.built
+    while (frame.next <= frame.end) {
+        int n = 0;
+        Word rest = (candidates & (((Word)2 << frame.end) - 1)) >> frame.next;
+        while (rest != 0 && n < SUMSET_SIBLINGS) {
+            int i = frame.next + __builtin_ctzll(rest);
+            rest &= rest - 1;
+            frame.built = i;
+
+            bool child_trivial = is_shifted_intersection_empty(a, b, i);
+            STAT_ADD(child_trivial ? STAT_TRIVIAL : STAT_NONTRIVIAL, 1);
+            bool child_leaf = !child_trivial && a->sum + i == b->sum && is_shifted_intersection_solution(a, b, i);
+            if (!child_trivial && !child_leaf && options.bound)
+                continue;
+            xs[n] = i;
+            trivial[n] = child_trivial;
+            leaf[n++] = child_leaf;
+        }
+        if (rest == 0)
+            frame.built = frame.end;
+        frame.next = frame.built + 1;
+
+        SumsetArenaMark mark = sumset_arena_mark(arena);
+        for (int k = 0; k < n; ++k)
+            children[k] = sumset_arena_alloc(arena, a->sum + xs[k]);
+        sumset_add_siblings(children, a, xs, n);
+        for (int k = 0; k < n; ++k) {
+            int child_best = 0;
+            frame.current = xs[k];
+            if (trivial[k]) {
+                child_best = solve_trivial(children[k], b, thread_data);
+            } else if (leaf[k]) {
+                update_solution(&thread_data->local_solution, children[k], b);
+                child_best = b->sum;
+            }
+            if (child_best > best)
+                best = child_best;
+        }
+        sumset_arena_release(arena, mark);
+    }
 
-static void solve_classic(const Sumset* a, const Sumset* b, Solution* thread_solution)
+    deque->bottom--;
+    if (deque->top > deque->bottom)
+        deque->top = deque->bottom;
+    return (frame.end < end) ? INCOMPLETE : best;
+}
+
+// Solves (a, b) knowing that s(a) ∩ s(b) = {0}.
+// Returns the result of the subtree (see INCOMPLETE).
+static int solve_trivial(const Sumset* a, const Sumset* b, ThreadData* thread_data)
 {
     if (a->sum > b->sum)
-        return solve_classic(b, a, thread_solution);
+        return solve_trivial(b, a, thread_data);
+
+    poll_request(thread_data, a, b);
+    add_relaxed(&thread_data->nodes, 1);
+    // Above the ceiling there are no solutions, otherwise the whole search is stopping
+    if (can_prune(b))
+        return (options.bound && b->sum > ceiling) ? 0 : INCOMPLETE;
+    // Only near the root: deeper subtrees are so small that hashing the state costs more than they do
+    if (!options.bound || 2 * a->last > input_data.d)
+        return solve_children(a, b, a->last, input_data.d, thread_data);
+
+    int cached = cache_lookup(&cache, a, b);
+    if (cached >= 0 && cached <= atomic_load_explicit(&incumbent, memory_order_relaxed))
+        return cached;
+    if (transposition_visit(&table, a, b))
+        return INCOMPLETE;
+
+    long nodes = atomic_load_explicit(&thread_data->nodes, memory_order_relaxed);
+    int best = solve_children(a, b, a->last, input_data.d, thread_data);
+    if (cache_enabled(&cache) && cached < 0 && best != INCOMPLETE
+        && atomic_load_explicit(&thread_data->nodes, memory_order_relaxed) - nodes >= CACHE_MIN_NODES)
+        cache_record(&cache, a, b, best);
+    return best;
+}
+
+static void solve_classic(const Sumset* a, const Sumset* b, ThreadData* thread_data)
+{
+    if (a->sum > b->sum)
+        return solve_classic(b, a, thread_data);
 
     if (is_sumset_intersection_trivial(a, b)) { // s(a) ∩ s(b) = {0}.
-        for (size_t i = a->last; i <= input_data.d; ++i) {
-            if (!does_sumset_contain(b, i)) {
-                Sumset a_with_i;
-                sumset_add(&a_with_i, a, i);
-                solve_classic(&a_with_i, b, thread_solution);
-            }
+        solve_trivial(a, b, thread_data);
+    } else if ((a->sum == b->sum) && is_sumset_intersection_solution(a, b)) { // s(a) ∩ s(b) = {0, ∑b}.
+        update_solution(&thread_data->local_solution, a, b);
+    }
+}
+
+// Asks random threads for work until nobody has any.
+static void steal_work(ThreadData* thread_data)
+{
+    while (atomic_load(&active) > 0) {
+        poll_request(thread_data, NULL, NULL);
+
+        ThreadData* victim = &all_thread_data[rand_r(&thread_data->seed) % thread_count];
+        int expected = NO_REQUEST;
+        atomic_store_explicit(&thread_data->response, WAITING, memory_order_relaxed);
+        if (victim == thread_data || !atomic_compare_exchange_strong(&victim->request, &expected, thread_data->id)) {
+            sched_yield();
+            continue;
+        }
+
+        // Others may be waiting for us in the meantime
+        int response;
+        while ((response = atomic_load_explicit(&thread_data->response, memory_order_acquire)) == WAITING) {
+            poll_request(thread_data, NULL, NULL);
+            sched_yield();
         }
-    } else if ((a->sum == b->sum) && (get_sumset_intersection_size(a, b) == 2)) { // s(a) ∩ s(b) = {0, ∑b}.
-        if (b->sum > thread_solution->sum) {
-            solution_build(thread_solution, &input_data, a, b);
+
+        if (response == ACCEPTED) {
+            STAT_ADD(STAT_STEAL, 1);
+            Frame* stolen = &thread_data->stolen;
+            solve_children(stolen->a, stolen->b, stolen->next, stolen->end, thread_data);
+            // A checkpoint only writes the stolen frame while we haven't started it
+            atomic_store_explicit(&thread_data->response, WAITING, memory_order_relaxed);
+            atomic_fetch_sub(&active, 1);
         }
     }
+
+    int expected = NO_REQUEST;
+    while (!atomic_compare_exchange_strong(&thread_data->request, &expected, CLOSED)) {
+        handle_request(thread_data, NULL, NULL);
+        expected = NO_REQUEST;
+    }
 }
 
-void* thread_function(void* arg) {
-    ThreadData* thread_data = (ThreadData*)arg;
+// Returns the index of the next task, waiting until it's published, or -1 if all tasks were taken.
+static int take_task(ThreadData* thread_data)
+{
+    int task_idx = atomic_load(&taken);
     while (true) {
-        int task_idx = atomic_fetch_sub(&zz, 1) - 1;
+        bool done = atomic_load_explicit(&frontier_done, memory_order_acquire);
+        if (task_idx < atomic_load_explicit(&published, memory_order_acquire)) {
+            if (atomic_compare_exchange_weak(&taken, &task_idx, task_idx + 1)) {
+                STAT_ADD(STAT_TASK, 1);
+                return task_idx;
+            }
+        } else if (done) {
+            return -1;
+        } else {
+            poll_request(thread_data, NULL, NULL);
+            sched_yield();
+            task_idx = atomic_load(&taken);
+        }
+    }
+}
+
+static void process_tasks(ThreadData* thread_data)
+{
+    while (true) {
+        int task_idx = take_task(thread_data);
         if (task_idx < 0)   // there is no more tasks
             break;
 
         const Sumset* a = tab_tasks[task_idx].a;
         const Sumset* b = tab_tasks[task_idx].b;
         int i = tab_tasks[task_idx].i;
+        long weight = task_weight(&tab_tasks[task_idx]);
 
+        // A node of a resumed checkpoint, solved itself
+        if (i == 0) {
+            solve_classic(a, b, thread_data);
+            add_relaxed(&thread_data->task_weight, weight);
+            continue;
+        }
         if (a->sum > b->sum) {
             const Sumset* tmp = a;
             a = b;
             b = tmp;
         }
 
-        Sumset a_with_i;
-        sumset_add(&a_with_i, a, i);
-        solve_classic(&a_with_i, b, &thread_data->local_solution);
+        Sumset* a_with_i = sumset_arena_alloc(&thread_data->arena, a->sum + i);
+        sumset_add(a_with_i, a, i);
+        solve_classic(a_with_i, b, thread_data);
+        sumset_arena_clear(&thread_data->arena);
+        add_relaxed(&thread_data->task_weight, weight);
     }
+    atomic_fetch_sub(&active, 1);
+
+    // Help the others with their subtrees
+    steal_work(thread_data);
+}
+
+// Tells the main thread (waiting between checkpoints) that we returned.
+static void thread_finished(void)
+{
+    ASSERT_ZERO(pthread_mutex_lock(&pause_mutex));
+    finished++;
+    ASSERT_ZERO(pthread_cond_broadcast(&pause_cond));
+    ASSERT_ZERO(pthread_mutex_unlock(&pause_mutex));
+}
+
+void* thread_function(void* arg) {
+    stats_thread_start();
+    process_tasks((ThreadData*)arg);
+    stats_thread_stop();
+    thread_finished();
     return NULL;
 }
 
-static void solve(const Sumset* a, const Sumset* b, int level) {
-    if (a->sum > b->sum)
-        return solve(b, a, level);
+static void heap_push(Task task)
+{
+    int k = heap_size++;
+    while (k > 0 && heap[(k - 1) / 2].size < task.size) {
+        heap[k] = heap[(k - 1) / 2];
+        k = (k - 1) / 2;
+    }
+    heap[k] = task;
+}
 
-    if (is_sumset_intersection_trivial(a, b)) { // s(a) ∩ s(b) = {0}.
-        for (size_t i = a->last; i <= input_data.d; ++i) {
-            if (!does_sumset_contain(b, i)) {
-                if (level <= task_level - 1) {
-                    sumset_add(&tab_sumset[s], a, i);
-                    s++;
-                    solve(&tab_sumset[s - 1], b, level + 1);
-                } else if (level == task_level) {
-                    tab_tasks[z] = (Task){a, b, i};
-                    z++;
-                }
+static Task heap_pop(void)
+{
+    Task top = heap[0];
+    Task last = heap[--heap_size];
+    int k = 0;
+    while (2 * k + 1 < heap_size) {
+        int child = 2 * k + 1;
+        if (child + 1 < heap_size && heap[child + 1].size > heap[child].size)
+            child++;
+        if (heap[child].size <= last.size)
+            break;
+        heap[k] = heap[child];
+        k = child;
+    }
+    heap[k] = last;
+    return top;
+}
+
+// Sets the scratch sumset result to (A ∪ {x})^Σ like sumset_add(), but without logging or counting it: the
+// estimates must not change the sumset_add calls, which are the same as those of reference.
+// Only the words up to the sums are read and written, as with SUMSET_BOUNDED. `result` must not be `a`.
+static void probe_add(Sumset* result, const Sumset* a, int x)
+{
+    int s = x / BITS_PER_WORD;
+    int r = x % BITS_PER_WORD;
+    int top = (a->sum + x) / BITS_PER_WORD;
+    for (int i = 0; i <= top; ++i)
+        result->sumset[i] = _sumset_word(a, i);
+    // From the top down, so the words read are still those of a
+    _sumset_shift_or(result->sumset, result->sumset, s + 1, top, s, r);
+    result->sumset[s] |= result->sumset[0] << r;
+    result->sum = a->sum + x;
+    result->last = x;
+    result->prev = a;
+}
+
+// Knuth's estimator of the number of nodes in the subtree of a + i: walks down random paths and averages
+// 1 + c_1 + c_1 c_2 + ..., where c_k is the number of children of the k-th node on the path.
+// The paths are built in scratch sumsets with probe_add(), so the logged builds split the tasks the same way.
+static double estimate_subtree(const Sumset* a, const Sumset* b, int i, unsigned* seed)
+{
+    Sumset path[2];
+    double total = 0;
+    for (int probe = 0; probe < PROBES; ++probe) {
+        probe_add(&path[0], a, i);
+        const Sumset *x = &path[0], *y = b;
+        int x_slot = 0, y_slot = -1; // Indices of x and y in path (-1 for an ancestor of the task)
+        double estimate = 1, weight = 1;
+        while (true) {
+            if (x->sum > y->sum) {
+                const Sumset* tmp = x;
+                x = y;
+                y = tmp;
+                int tmp_slot = x_slot;
+                x_slot = y_slot;
+                y_slot = tmp_slot;
+            }
+            if (!is_sumset_intersection_trivial(x, y))
+                break;
+
+            int children[MAX_D + 1];
+            int count = 0;
+            for (int j = x->last; j <= input_data.d; ++j) {
+                if (!does_sumset_contain(y, j))
+                    children[count++] = j;
             }
+            if (count == 0)
+                break;
+            weight *= count;
+            estimate += weight;
+
+            // The child replaces x if it's in path, y must stay intact
+            int slot = (x_slot >= 0) ? x_slot : 1 - y_slot;
+            probe_add(&path[slot], x, children[rand_r(seed) % count]);
+            x = &path[slot];
+            x_slot = slot;
         }
-    } else if ((a->sum == b->sum) && (get_sumset_intersection_size(a, b) == 2)) {
-        if (b->sum > best_solution.sum)
-            solution_build(&best_solution, &input_data, a, b);
+        total += estimate;
     }
+    return total / PROBES;
 }
 
-void* main_solver_thread(void* arg) {
-    ThreadData* thread_data = (ThreadData*)arg;
-    solve(&input_data.a_start, &input_data.b_start, 1);
-    zz = z;
+// Estimates the number of nodes in the subtree of the node (a, b) itself, from those of its children.
+static double estimate_node(const Sumset* a, const Sumset* b, unsigned* seed)
+{
+    if (a->sum > b->sum)
+        return estimate_node(b, a, seed);
+    double size = 1;
+    if (is_sumset_intersection_trivial(a, b)) {
+        for (int i = a->last; i <= input_data.d; ++i) {
+            if (!does_sumset_contain(b, i))
+                size += estimate_subtree(a, b, i, seed);
+        }
+    }
+    return size;
+}
 
-    sem_post(&main_semaphore);
+static void publish_task(Task task)
+{
+    tab_tasks[z] = task;
+    z++;
+    atomic_store_explicit(&published, z, memory_order_release);
+}
 
-    while (true) {
-        int task_idx = atomic_fetch_sub(&zz, 1) - 1;
-        if (task_idx < 0)   // there is no more other tasks
-            break;
+// Pushes the children of the node (a, b) bigger than threshold to the heap and publishes the others,
+// or updates the solution if it's a leaf.
+static void expand_node(const Sumset* a, const Sumset* b, double threshold, unsigned* seed)
+{
+    if (a->sum > b->sum)
+        return expand_node(b, a, threshold, seed);
+    if (can_prune(b))
+        return;
 
-        const Sumset* a = tab_tasks[task_idx].a;
-        const Sumset* b = tab_tasks[task_idx].b;
-        int i = tab_tasks[task_idx].i;
+    if (is_sumset_intersection_trivial(a, b)) { // s(a) ∩ s(b) = {0}.
+        for (int i = a->last; i <= input_data.d; ++i) {
+            if (does_sumset_contain(b, i))
+                continue;
+            Task task = { a, b, i, estimate_subtree(a, b, i, seed) };
+            if (task.size > threshold)
+                heap_push(task);
+            else
+                publish_task(task);
+        }
+    } else if ((a->sum == b->sum) && is_sumset_intersection_solution(a, b)) {
+        update_solution(&best_solution, a, b);
+    }
+}
 
-        if (a->sum > b->sum) {
-            const Sumset* tmp = a;
-            a = b;
-            b = tmp;
+// Splits the biggest tasks until all of them are small enough, largest first. The tasks small enough are
+// published as soon as they are estimated, so the other threads search them while the big ones are split.
+static void generate_tasks(void)
+{
+    unsigned seed = 0;
+    // The threshold depends on the size of the whole tree, so the children of the root all wait in the heap
+    expand_node(&input_data.a_start, &input_data.b_start, INFINITY, &seed);
+
+    double total = 0;
+    for (int k = 0; k < heap_size; ++k)
+        total += heap[k].size;
+    double threshold = total / (SPLIT_FACTOR * thread_count);
+    if (threshold < MIN_SPLIT_SIZE)
+        threshold = MIN_SPLIT_SIZE;
+
+    while (heap_size > 0) {
+        Task task = heap_pop();
+        if (task.size > threshold && s < tab_sumset_size) {
+            Sumset* child = sumset_arena_alloc(&tab_sumset, task.a->sum + task.i);
+            sumset_add(child, task.a, task.i);
+            s++;
+            expand_node(child, task.b, threshold, &seed);
+        } else {
+            publish_task(task);
+        }
+    }
+}
+
+// A node of the trie of the paths in a resumed checkpoint, with the sumset the path leads to
+typedef struct PathTrie {
+    const Sumset* sumset;
+    struct PathTrie* children[MAX_D + 1];
+} PathTrie;
+
+// Returns the sumset of the path from root, building the missing ones in tab_sumset.
+// The frames share most of their paths, so few sumsets are built.
+static const Sumset* trie_walk(PathTrie* root, const uint8_t* path, int length)
+{
+    PathTrie* node = root;
+    for (int k = 0; k < length; ++k) {
+        PathTrie** child = &node->children[path[k]];
+        if (*child == NULL) {
+            *child = calloc(1, sizeof(PathTrie));
+            if (*child == NULL)
+                exit(1);
+            Sumset* sumset = sumset_arena_alloc(&tab_sumset, node->sumset->sum + path[k]);
+            sumset_add(sumset, node->sumset, path[k]);
+            (*child)->sumset = sumset;
+        }
+        node = *child;
+    }
+    return node->sumset;
+}
+
+static void trie_free(PathTrie* node)
+{
+    for (int x = 0; x <= MAX_D; ++x) {
+        if (node->children[x] != NULL) {
+            trie_free(node->children[x]);
+            free(node->children[x]);
         }
+    }
+}
 
-        Sumset a_with_i;
-        sumset_add(&a_with_i, a, i);
-        solve_classic(&a_with_i, b, &thread_data->local_solution);
+// Publishes the frames of the resumed checkpoint as tasks: its nodes with i = 0, and the children of its ranges.
+static void resume_tasks(void)
+{
+    PathTrie a_root = { .sumset = &input_data.a_start }, b_root = { .sumset = &input_data.b_start };
+    unsigned seed = 0;
+    for (size_t k = 0; k < resumed.frame_count; ++k) {
+        CheckpointFrame frame = checkpoint_frame(&resumed, k);
+        const Sumset* a = trie_walk(&a_root, frame.a, frame.a_length);
+        const Sumset* b = trie_walk(&b_root, frame.b, frame.b_length);
+        if (frame.first == 0) {
+            publish_task((Task){ a, b, 0, options.progress_seconds > 0 ? estimate_node(a, b, &seed) : 0 });
+            continue;
+        }
+        const Sumset* extended = frame.extends_b ? b : a;
+        const Sumset* other = frame.extends_b ? a : b;
+        for (int i = frame.first; i <= frame.end; ++i) {
+            // The sizes are only needed for --progress-seconds
+            if (i >= extended->last && !does_sumset_contain(other, i))
+                publish_task((Task){ extended, other, i,
+                                     options.progress_seconds > 0 ? estimate_subtree(extended, other, i, &seed) : 0 });
+        }
     }
+    trie_free(&a_root);
+    trie_free(&b_root);
+}
 
+void* main_solver_thread(void* arg) {
+    stats_thread_start();
+    if (options.resume)
+        resume_tasks();
+    else
+        generate_tasks();
+    atomic_store_explicit(&frontier_done, true, memory_order_release);
+
+    process_tasks((ThreadData*)arg);
+    stats_thread_stop();
+    thread_finished();
     return NULL;
 }
 
-int main() {
+// Adds the frontier of a paused thread to the checkpoint: the node it was about to solve, the children
+// of its frames after those being solved, and the frame it received if it hasn't started it.
+static void checkpoint_thread(const ThreadData* thread_data)
+{
+    if (thread_data->paused_a != NULL)
+        checkpointer_add(&checkpointer, thread_data->paused_a, thread_data->paused_b, 0, 0);
+    const Deque* deque = &thread_data->deque;
+    for (int k = deque->bottom - 1; k >= 0; --k) {
+        const Frame* frame = deque->frames[k];
+        checkpointer_add(&checkpointer, frame->a, frame->b, frame->current + 1, frame->end);
+    }
+    const Frame* stolen = &thread_data->stolen;
+    if (deque->bottom == 0 && atomic_load_explicit(&thread_data->response, memory_order_acquire) == ACCEPTED)
+        checkpointer_add(&checkpointer, stolen->a, stolen->b, stolen->next, stolen->end);
+}
+
+// Pauses all threads still searching, and writes their frontiers, the tasks not taken yet and the best solution.
+// Called with pause_mutex locked, once all tasks are published.
+static void write_checkpoint(void)
+{
+    writing = true;
+    ASSERT_ZERO(pthread_mutex_unlock(&pause_mutex));
+    bool pausing[thread_count];
+    int count = 0;
+    for (int i = 0; i < thread_count; ++i) {
+        // A thread asked for work answers first, a closed one has nothing left
+        int expected = NO_REQUEST;
+        while (!atomic_compare_exchange_weak(&all_thread_data[i].request, &expected, PAUSE) && expected != CLOSED) {
+            expected = NO_REQUEST;
+            sched_yield();
+        }
+        pausing[i] = (expected != CLOSED);
+        count += pausing[i];
+    }
+    ASSERT_ZERO(pthread_mutex_lock(&pause_mutex));
+    while (paused < count)
+        ASSERT_ZERO(pthread_cond_wait(&pause_cond, &pause_mutex));
+
+    // Once --deadline-ms passed, the frames have children that were skipped instead of searched, and the previous
+    // checkpoint is kept. Threads only skip after seeing the flag, so it's enough to look once all are paused.
+    if (!deadline_passed()) {
+        Solution best = best_solution;
+        for (int i = 0; i < thread_count; ++i) {
+            if (all_thread_data[i].local_solution.sum > best.sum)
+                best = all_thread_data[i].local_solution;
+        }
+        checkpointer_begin(&checkpointer, &best);
+        for (int i = 0; i < thread_count; ++i) {
+            if (pausing[i])
+                checkpoint_thread(&all_thread_data[i]);
+        }
+        for (int k = atomic_load(&taken); k < atomic_load(&published); ++k) {
+            Task task = tab_tasks[k];
+            if (task.i == 0) {
+                checkpointer_add(&checkpointer, task.a, task.b, 0, 0);
+            } else if (task.a->sum > task.b->sum) {
+                checkpointer_add(&checkpointer, task.b, task.a, task.i, task.i);
+            } else {
+                checkpointer_add(&checkpointer, task.a, task.b, task.i, task.i);
+            }
+        }
+        checkpointer_commit(&checkpointer);
+    }
+
+    for (int i = 0; i < thread_count; ++i) {
+        if (pausing[i])
+            atomic_store_explicit(&all_thread_data[i].request, NO_REQUEST, memory_order_relaxed);
+    }
+    writing = false;
+    ASSERT_ZERO(pthread_cond_broadcast(&pause_cond));
+    while (paused > 0)
+        ASSERT_ZERO(pthread_cond_wait(&pause_cond, &pause_mutex));
+}
+
+// Waits for the threads to finish, writing a checkpoint every checkpointer.seconds.
+static void checkpoint_until_finished(void)
+{
+    ASSERT_ZERO(pthread_mutex_lock(&pause_mutex));
+    while (finished < thread_count) {
+        // The first checkpoint waits until all tasks are published, which takes a fraction of a second.
+        // After --deadline-ms, the threads are stopping and there are no more checkpoints.
+        bool later = !atomic_load(&frontier_done) || deadline_passed();
+        checkpointer_wait(&checkpointer, &pause_cond, &pause_mutex, later);
+        if (finished < thread_count && !later && !writing && checkpointer_due(&checkpointer))
+            write_checkpoint();
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&pause_mutex));
+}
+
+// Called by the timer of --deadline-ms: writes the frontier where the search stops, for --resume.
+static void checkpoint_at_deadline(void)
+{
+    ASSERT_ZERO(pthread_mutex_lock(&pause_mutex));
+    while (writing)
+        ASSERT_ZERO(pthread_cond_wait(&pause_cond, &pause_mutex));
+    if (finished < thread_count && atomic_load(&frontier_done))
+        write_checkpoint();
+    ASSERT_ZERO(pthread_mutex_unlock(&pause_mutex));
+}
+
+// Samples the progress for --progress-seconds: the tasks finished, by their estimated sizes (see estimate_subtree()),
+// out of all tasks once they are all published. Parts of a task stolen by other threads count when the task's
+// own thread finishes it.
+static void sample_progress(ProgressSample* sample)
+{
+    if (atomic_load_explicit(&frontier_done, memory_order_acquire)) {
+        int count = atomic_load_explicit(&published, memory_order_acquire);
+        for (int k = 0; k < count; ++k)
+            sample->total += task_weight(&tab_tasks[k]);
+    }
+    for (int i = 0; i < thread_count; ++i) {
+        sample->done += atomic_load_explicit(&all_thread_data[i].task_weight, memory_order_relaxed);
+        sample->nodes += atomic_load_explicit(&all_thread_data[i].nodes, memory_order_relaxed);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    options_parse(&options, argc, argv);
+    // Before the threads start, the checkpoint at the deadline is skipped (there is no frontier yet)
+    deadline_start(options.deadline_ms, (options.checkpoint_path != NULL) ? checkpoint_at_deadline : NULL);
+    if (options.batch) {
+        batch_run(options.bound);
+        stats_print();
+        return 0;
+    }
     input_data_read(&input_data);
     // input_data_init(&input_data, 1, 3, (int[]){0}, (int[]){0});
     solution_init(&best_solution);
+    if (options.table_mib > TABLE_MIB_PER_THREAD * input_data.t)
+        fatal("--table-mib can be at most %d MiB per thread", TABLE_MIB_PER_THREAD);
 
-    size_t max_tasks = input_data.d * input_data.d * input_data.d;
-    size_t tab_sumset_size = input_data.d * input_data.d + input_data.d;
+    if (options.bound) {
+        ceiling = alpha_ceiling(&input_data);
+        solution_seed(&best_solution, &input_data);
+    }
+    checkpoint_init(&resumed);
+    if (options.resume)
+        checkpoint_read(&resumed, options.checkpoint_path, &input_data, options.bound, ceiling, &best_solution);
+    checkpointer_init(&checkpointer, options.checkpoint_path, options.checkpoint_seconds, &input_data, options.bound,
+                      ceiling);
+    if (options.bound) {
+        atomic_init(&incumbent, best_solution.sum);
+        if (best_solution.sum >= ceiling) {
+            checkpointer_finish(&checkpointer);
+            stats_print();
+            solution_print(&best_solution);
+            deadline_print();
+            return 0;
+        }
+        transposition_init(&table, options.table_mib);
+    }
+    cache_open(&cache, options.cache_path, input_data.d);
 
-    tab_sumset = (Sumset*)malloc(tab_sumset_size * sizeof(Sumset));
-    if (tab_sumset == NULL) {
-        exit(1);
+    // Every split takes one task from the heap and adds at most d, so this many tasks fit
+    size_t max_tasks = input_data.d * input_data.d * input_data.d;
+    // A resumed checkpoint has a task per node and per child of a range
+    size_t resumed_tasks = 0;
+    for (size_t k = 0; k < resumed.frame_count; ++k) {
+        CheckpointFrame frame = checkpoint_frame(&resumed, k);
+        resumed_tasks += (frame.first == 0) ? 1 : frame.end - frame.first + 1;
     }
+    if (resumed_tasks > max_tasks)
+        max_tasks = resumed_tasks;
+    tab_sumset_size = input_data.d * input_data.d + input_data.d;
+
+    sumset_arena_init(&tab_sumset, SUMSET_ARENA_BLOCK_BYTES);
     tab_tasks = (Task*)malloc(max_tasks * sizeof(Task));
     if (tab_tasks == NULL) {
-        free(tab_sumset);
+        sumset_arena_free(&tab_sumset);
+        exit(1);
+    }
+    heap = (Task*)malloc(max_tasks * sizeof(Task));
+    if (heap == NULL) {
         exit(1);
     }
 
-    sem_init(&main_semaphore, 0, 0);
-    const int thread_count = input_data.t;
+    thread_count = input_data.t;
     pthread_t threads[thread_count];
-    ThreadData thread_data[thread_count];
 
+    all_thread_data = (ThreadData*)aligned_alloc(alignof(ThreadData), thread_count * sizeof(ThreadData));
+    if (all_thread_data == NULL) {
+        exit(1);
+    }
     for (int i = 0; i < thread_count; ++i) {
-        solution_init(&thread_data[i].local_solution);
+        ThreadData* thread_data = &all_thread_data[i];
+        atomic_init(&thread_data->request, NO_REQUEST);
+        atomic_init(&thread_data->response, WAITING);
+        // Received work needs copies of two chains of sumsets, the arenas grow with the depth of the search
+        sumset_arena_init(&thread_data->chain, SUMSET_ARENA_BLOCK_BYTES);
+        sumset_arena_init(&thread_data->arena, SUMSET_ARENA_BLOCK_BYTES);
+        thread_data->deque.top = thread_data->deque.bottom = 0;
+        thread_data->paused_a = thread_data->paused_b = NULL;
+        atomic_init(&thread_data->nodes, 0);
+        atomic_init(&thread_data->task_weight, 0);
+        solution_init(&thread_data->local_solution);
+        thread_data->seed = i;
+        thread_data->id = i;
     }
-
+    atomic_init(&active, thread_count);
+    atomic_init(&published, 0);
+    atomic_init(&taken, 0);
+    atomic_init(&frontier_done, false);
+    // The main thread waits for the next checkpoint on the monotonic clock of checkpointer_due()
+    pthread_condattr_t cond_attr;
+    ASSERT_ZERO(pthread_condattr_init(&cond_attr));
+    ASSERT_ZERO(pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC));
+    ASSERT_ZERO(pthread_cond_init(&pause_cond, &cond_attr));
+    ASSERT_ZERO(pthread_condattr_destroy(&cond_attr));
+
+    pthread_attr_t attr;
+    ASSERT_ZERO(pthread_attr_init(&attr));
+    ASSERT_ZERO(pthread_attr_setstacksize(&attr, THREAD_STACK_BYTES));
+    // The other threads start consuming tasks as soon as the first one is published
     for (int i = 0; i < thread_count; ++i) {
-        if (i == 0) {
-            pthread_create(&threads[i], NULL, main_solver_thread, &thread_data[i]);
-            sem_wait(&main_semaphore);
-        } else {
-            pthread_create(&threads[i], NULL, thread_function, &thread_data[i]);
-        }
+        pthread_create(&threads[i], &attr, (i == 0) ? main_solver_thread : thread_function, &all_thread_data[i]);
     }
+    ASSERT_ZERO(pthread_attr_destroy(&attr));
 
+    progress_start(options.progress_seconds, sample_progress);
+    if (checkpointer_enabled(&checkpointer))
+        checkpoint_until_finished();
     for (int i = 0; i < thread_count; ++i) {
         pthread_join(threads[i], NULL);
     }
+    progress_stop();
+    // A stopped search keeps its last checkpoint for --resume
+    if (!deadline_stopped())
+        checkpointer_finish(&checkpointer);
 
     // Collecting results
     size_t max_ind = 0;
-    int best_sum = thread_data[0].local_solution.sum;
+    int best_sum = all_thread_data[0].local_solution.sum;
     for (size_t i = 1; i < thread_count; ++i) {
-        if (thread_data[i].local_solution.sum > best_sum) {
+        if (all_thread_data[i].local_solution.sum > best_sum) {
             max_ind = i;
-            best_sum = thread_data[i].local_solution.sum;
+            best_sum = all_thread_data[i].local_solution.sum;
         }
     }
     if (best_sum > best_solution.sum) {
-        best_solution = thread_data[max_ind].local_solution;
+        best_solution = all_thread_data[max_ind].local_solution;
     }
 
-    free(tab_sumset);
+    for (int i = 0; i < thread_count; ++i) {
+        sumset_arena_free(&all_thread_data[i].chain);
+        sumset_arena_free(&all_thread_data[i].arena);
+    }
+    free(all_thread_data);
+    sumset_arena_free(&tab_sumset);
     free(tab_tasks);
-
+    free(heap);
+    transposition_free(&table);
+    cache_close(&cache);
+    checkpointer_free(&checkpointer);
+    checkpoint_free(&resumed);
+    ASSERT_ZERO(pthread_cond_destroy(&pause_cond));
+
+    stats_print();
     solution_print(&best_solution);
+    deadline_print();
     return 0;
 }
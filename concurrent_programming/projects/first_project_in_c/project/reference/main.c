@@ -7,19 +7,39 @@ static InputData input_data;
 
 static Solution best_solution;
 
+static void solve(const Sumset* a, const Sumset* b);
+
+// Solves the children a + xs[k], k < n, built together in one pass over a.
+static void solve_siblings(const Sumset* a, const Sumset* b, const int* xs, int n)
+{
+    Sumset children[SUMSET_SIBLINGS];
+    Sumset* batch[SUMSET_SIBLINGS];
+    for (int k = 0; k < n; ++k)
+        batch[k] = &children[k];
+
+    sumset_add_siblings(batch, a, xs, n);
+    for (int k = 0; k < n; ++k)
+        solve(&children[k], b);
+}
+
 static void solve(const Sumset* a, const Sumset* b)
 {
     if (a->sum > b->sum)
         return solve(b, a);
 
     if (is_sumset_intersection_trivial(a, b)) { // s(a) ∩ s(b) = {0}.
+        int xs[SUMSET_SIBLINGS];
+        int n = 0;
         for (size_t i = a->last; i <= input_data.d; ++i) {
             if (!does_sumset_contain(b, i)) {
-                Sumset a_with_i;
-                sumset_add(&a_with_i, a, i);
-                solve(&a_with_i, b);
+                xs[n++] = i;
+                if (n == SUMSET_SIBLINGS) {
+                    solve_siblings(a, b, xs, n);
+                    n = 0;
+                }
             }
         }
+        solve_siblings(a, b, xs, n);
     } else if ((a->sum == b->sum) && (get_sumset_intersection_size(a, b) == 2)) { // s(a) ∩ s(b) = {0, ∑b}.
         if (b->sum > best_solution.sum)
             solution_build(&best_solution, &input_data, a, b);
@@ -0,0 +1,248 @@
+// The coordinator of sharded: expands the top of the search, hands out its nodes as tasks to worker processes
+// and merges their best solutions.
+#define _GNU_SOURCE
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "common/err.h"
+#include "nonrecursive/solve.h"
+#include "sharded/protocol.h"
+#include "sharded/shard.h"
+
+// A level of the breadth-first expansion. The sumsets of all levels are kept, the later ones point to them.
+typedef struct {
+    SolveNode* nodes;
+    Sumset* sumsets;
+    int count;
+} Level;
+
+// Largest number of connections served at once
+#define MAX_CONNECTIONS 256
+
+static void update_solution(Solution* best_solution, const InputData* input_data, const Sumset* a, const Sumset* b)
+{
+    if (b->sum > best_solution->sum)
+        solution_build(best_solution, (InputData*)input_data, a, b);
+}
+
+// Expands the nodes of level into next (see solve_nonrecursive_expand()).
+static void level_expand(const Level* level, Level* next, const InputData* input_data, bool bound, int ceiling,
+                         Solution* best_solution)
+{
+    int d = input_data->d;
+    next->nodes = malloc(sizeof(SolveNode) * level->count * d);
+    next->sumsets = malloc(sizeof(Sumset) * level->count * d);
+    if (next->nodes == NULL || next->sumsets == NULL)
+        exit(1);
+    next->count = solve_nonrecursive_expand(input_data, bound, ceiling, level->nodes, level->count, next->nodes,
+                                            next->sumsets, best_solution);
+}
+
+// Writes the elements added to the start sumset on the way to s, in the order they were added. Returns their number.
+static int path_of(const Sumset* s, uint8_t* path)
+{
+    int length = 0;
+    for (const Sumset* p = s; p->prev != NULL; p = p->prev)
+        ++length;
+    int k = length;
+    for (const Sumset* p = s; p->prev != NULL; p = p->prev)
+        path[--k] = p->sum - p->prev->sum;
+    return length;
+}
+
+typedef struct {
+    int fd;
+    int task; // The task the worker is solving, -1 if none
+} Connection;
+
+typedef struct {
+    ShardTask* tasks;
+    int count;
+    int* pending; // Stack of tasks to hand out (those of workers that disconnected are put back)
+    int pending_count;
+    int done;
+    Connection connections[MAX_CONNECTIONS];
+    int connection_count;
+} Server;
+
+static void server_disconnect(Server* server, int k)
+{
+    Connection* connection = &server->connections[k];
+    if (connection->task >= 0)
+        server->pending[server->pending_count++] = connection->task;
+    ASSERT_SYS_OK(close(connection->fd));
+    server->connections[k] = server->connections[--server->connection_count];
+}
+
+// Gives the pending tasks to the idle connections. Idle workers stay connected until the end,
+// to take the tasks of workers that disconnect.
+static void server_dispatch(Server* server)
+{
+    for (int k = server->connection_count - 1; k >= 0 && server->pending_count > 0; --k) {
+        Connection* connection = &server->connections[k];
+        if (connection->task >= 0)
+            continue;
+        connection->task = server->pending[--server->pending_count];
+        if (!socket_send(connection->fd, &server->tasks[connection->task], sizeof(ShardTask)))
+            server_disconnect(server, k);
+    }
+}
+
+static void server_accept(Server* server, int listener, const ShardJob* job)
+{
+    int fd = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+    ASSERT_SYS_OK(fd);
+    if (server->connection_count == MAX_CONNECTIONS || !socket_send(fd, job, sizeof(*job))) {
+        ASSERT_SYS_OK(close(fd));
+        return;
+    }
+    server->connections[server->connection_count++] = (Connection){ fd, -1 };
+}
+
+// Receives a result from connection k and merges it. A worker that disconnected gives its task back.
+static void server_receive(Server* server, int k, Solution* best_solution)
+{
+    Connection* connection = &server->connections[k];
+    ShardResult result;
+    if (!socket_receive(connection->fd, &result, sizeof(result))) {
+        server_disconnect(server, k);
+        return;
+    }
+    if (connection->task < 0 || result.id != (uint32_t)connection->task)
+        fatal("A worker answered task %u instead of %d", result.id, connection->task);
+    connection->task = -1;
+    server->done++;
+
+    if (result.sum > best_solution->sum) {
+        best_solution->sum = result.sum;
+        for (int x = 0; x <= MAX_D; ++x) {
+            best_solution->a.count[x] = result.a[x];
+            best_solution->b.count[x] = result.b[x];
+        }
+    }
+}
+
+// Starts a worker process, running this executable with --worker.
+static pid_t worker_start(const char* socket_path)
+{
+    // The path itself rather than /proc/self/exe, so that the workers are named sharded
+    char executable[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+    ASSERT_SYS_OK(length);
+    executable[length] = '\0';
+
+    pid_t pid = fork();
+    ASSERT_SYS_OK(pid);
+    if (pid == 0) {
+        execl(executable, executable, "--worker", socket_path, (char*)NULL);
+        syserr("Cannot start a worker");
+    }
+    return pid;
+}
+
+void shard_coordinate(const InputData* input_data, bool bound, int ceiling, int workers, int tasks,
+                      const char* socket_path, Solution* best_solution)
+{
+    const Sumset* a = &input_data->a_start;
+    const Sumset* b = &input_data->b_start;
+    if (!is_sumset_intersection_trivial(a, b)) {
+        // The root is the only node
+        if (a->sum == b->sum && is_sumset_intersection_solution(a, b))
+            update_solution(best_solution, input_data, a, b);
+        return;
+    }
+
+    // The levels of the expansion, up to the one that is handed out
+    Level levels[SHARD_MAX_PATH + 1];
+    int depth = 0;
+    levels[0] = (Level){ malloc(sizeof(SolveNode)), NULL, 1 };
+    if (levels[0].nodes == NULL)
+        exit(1);
+    levels[0].nodes[0] = (SolveNode){ a, b };
+    while (levels[depth].count > 0 && levels[depth].count < tasks && depth < SHARD_MAX_PATH) {
+        if (bound && best_solution->sum >= ceiling)
+            break;
+        level_expand(&levels[depth], &levels[depth + 1], input_data, bound, ceiling, best_solution);
+        ++depth;
+    }
+
+    Server server = { .count = 0, .done = 0, .pending_count = 0, .connection_count = 0 };
+    if (!bound || best_solution->sum < ceiling)
+        server.count = levels[depth].count;
+    server.tasks = malloc(sizeof(ShardTask) * (server.count + 1));
+    server.pending = malloc(sizeof(int) * (server.count + 1));
+    if (server.tasks == NULL || server.pending == NULL)
+        exit(1);
+    for (int k = 0; k < server.count; ++k) {
+        ShardTask* task = &server.tasks[k];
+        task->id = k;
+        task->a_length = path_of(levels[depth].nodes[k].a, task->path);
+        task->b_length = path_of(levels[depth].nodes[k].b, task->path + task->a_length);
+        // The first tasks of the search are handed out first
+        server.pending[server.pending_count++] = server.count - 1 - k;
+    }
+
+    ShardJob job = { .d = input_data->d, .bound = bound, .ceiling = ceiling };
+    for (int x = 0; x <= MAX_D; ++x) {
+        job.a_in[x] = input_data->a_in.count[x];
+        job.b_in[x] = input_data->b_in.count[x];
+    }
+
+    int listener = socket_listen(socket_path);
+    pid_t* pids = malloc(sizeof(pid_t) * (workers + 1));
+    if (pids == NULL)
+        exit(1);
+    int alive = 0;
+    for (int k = 0; k < workers && server.count > 0; ++k)
+        pids[alive++] = worker_start(socket_path);
+    int started = alive;
+
+    while (server.done < server.count && !(bound && best_solution->sum >= ceiling)) {
+        struct pollfd fds[MAX_CONNECTIONS + 1];
+        fds[0] = (struct pollfd){ .fd = listener, .events = POLLIN };
+        for (int k = 0; k < server.connection_count; ++k)
+            fds[k + 1] = (struct pollfd){ .fd = server.connections[k].fd, .events = POLLIN };
+        int count = server.connection_count;
+        // The timeout only checks for workers that exited
+        int ready = poll(fds, count + 1, 1000);
+        ASSERT_SYS_OK(ready);
+
+        // Backwards, since a closed connection is replaced by the last one
+        for (int k = count - 1; k >= 0; --k)
+            if (fds[k + 1].revents != 0)
+                server_receive(&server, k, best_solution);
+        if (fds[0].revents & POLLIN)
+            server_accept(&server, listener, &job);
+        server_dispatch(&server);
+
+        int status;
+        while (alive > 0 && waitpid(-1, &status, WNOHANG) > 0)
+            --alive;
+        if (started > 0 && alive == 0 && server.connection_count == 0 && server.done < server.count)
+            fatal("All workers exited with %d tasks left", server.count - server.done);
+    }
+
+    // Other workers exit when their connection is closed. The started ones are also stopped if they are
+    // still searching (once a solution reaches the ceiling) or haven't connected yet.
+    for (int k = 0; k < server.connection_count; ++k)
+        ASSERT_SYS_OK(close(server.connections[k].fd));
+    ASSERT_SYS_OK(close(listener));
+    ASSERT_SYS_OK(unlink(socket_path));
+    for (int k = 0; k < started; ++k)
+        kill(pids[k], SIGTERM);
+    while (alive > 0 && wait(NULL) > 0)
+        --alive;
+
+    for (int k = 0; k <= depth; ++k) {
+        free(levels[k].nodes);
+        free(levels[k].sumsets);
+    }
+    free(server.tasks);
+    free(server.pending);
+    free(pids);
+}
@@ -0,0 +1,74 @@
+// Solves the task of reference with worker processes instead of threads, reading the same input and printing
+// the same output. Usage:
+//   sharded [--bound] [--workers N] [--tasks N] [--socket PATH]   the coordinator, reading the task from stdin
+//   sharded --worker PATH                                        a worker of the coordinator listening at PATH
+// The coordinator starts N workers (default: t of the input), and hands out at least --tasks subtrees
+// (default: 16 per worker). Workers started by hand can join through --socket (default: a new path in /tmp).
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "common/bound.h"
+#include "common/err.h"
+#include "common/io.h"
+#include "sharded/shard.h"
+
+static InputData input_data;
+static Solution best_solution;
+
+static int parse_count(const char* text, const char* name)
+{
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || value < 0 || value > 4096)
+        fatal("%s needs a number in 0..4096", name);
+    return value;
+}
+
+int main(int argc, char* argv[])
+{
+    bool bound = false;
+    int workers = -1, tasks = -1;
+    const char* socket_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        const char* option = argv[i];
+        if (strcmp(option, "--bound") == 0)
+            bound = true;
+        else if (i + 1 == argc)
+            fatal("%s needs a value", option);
+        else if (strcmp(option, "--worker") == 0) {
+            shard_work(argv[i + 1]);
+            return 0;
+        } else if (strcmp(option, "--workers") == 0)
+            workers = parse_count(argv[++i], option);
+        else if (strcmp(option, "--tasks") == 0)
+            tasks = parse_count(argv[++i], option);
+        else if (strcmp(option, "--socket") == 0)
+            socket_path = argv[++i];
+        else
+            fatal("Unknown option: %s", option);
+    }
+
+    input_data_read(&input_data);
+    if (workers < 0)
+        workers = input_data.t;
+    if (tasks < 0)
+        tasks = 16 * (workers > 0 ? workers : 1);
+    char default_path[64];
+    if (socket_path == NULL) {
+        snprintf(default_path, sizeof(default_path), "/tmp/sharded.%d.sock", (int)getpid());
+        socket_path = default_path;
+    }
+
+    solution_init(&best_solution);
+    // With --bound: no solution has a bigger sum than ceiling
+    int ceiling = 0;
+    if (bound) {
+        ceiling = alpha_ceiling(&input_data);
+        solution_seed(&best_solution, &input_data);
+    }
+    shard_coordinate(&input_data, bound, ceiling, workers, tasks, socket_path, &best_solution);
+
+    solution_print(&best_solution);
+    return 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "common/io.h"
+#include "common/socket.h"
+
+// Messages between the coordinator and the workers of sharded, over a Unix domain stream socket.
+//
+// A worker connects and receives a ShardJob, then a ShardTask. It answers each task with a ShardResult and gets
+// the next task, until the coordinator closes the connection. A task is a subtree of the search, given by the
+// elements added to A_0 and B_0 on the path from the root, so the worker rebuilds its sumsets without pointers.
+// The messages are plain structs (sent with common/socket.h): both sides run on the same machine.
+
+// Longest path from the root to a task (elements added to A_0 and B_0 together)
+#define SHARD_MAX_PATH 64
+
+// Sent once to each worker: the input and the mode of the search
+typedef struct ShardJob {
+    int32_t d;
+    int32_t bound; // 1 with --bound
+    int32_t ceiling;
+    uint16_t a_in[MAX_D + 1], b_in[MAX_D + 1]; // Counts of the elements of A_0 and B_0
+} ShardJob;
+
+// The subtree of the node reached by adding path[0 .. a_length) to A_0 and path[a_length .. a_length + b_length)
+// to B_0, each in the order of the search
+typedef struct ShardTask {
+    uint32_t id;
+    uint8_t a_length, b_length;
+    uint8_t path[SHARD_MAX_PATH];
+} ShardTask;
+
+// The best solution in the subtree of task id (sum 0 if there is none)
+typedef struct ShardResult {
+    uint32_t id;
+    int32_t sum;
+    uint16_t a[MAX_D + 1], b[MAX_D + 1];
+} ShardResult;
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdbool.h>
+#include "common/io.h"
+
+// Searches from input_data with worker processes (see protocol.h), keeping the best solution in best_solution.
+// The coordinator expands the search breadth-first until it has at least tasks nodes (or the search is done),
+// and serves them on a socket at socket_path. It starts workers processes itself, other workers can connect
+// to the socket. With bound, as in nonrecursive: subtrees above ceiling are skipped, and a solution reaching it
+// ends the search.
+void shard_coordinate(const InputData* input_data, bool bound, int ceiling, int workers, int tasks,
+                      const char* socket_path, Solution* best_solution);
+
+// Connects to the coordinator at socket_path and solves its tasks with the search of nonrecursive,
+// until the coordinator closes the connection.
+void shard_work(const char* socket_path);
@@ -0,0 +1,69 @@
+// A worker of sharded: solves the subtrees sent by the coordinator with the search of nonrecursive.
+#include <string.h>
+#include <unistd.h>
+#include "common/err.h"
+#include "nonrecursive/solve.h"
+#include "sharded/protocol.h"
+#include "sharded/shard.h"
+
+// Sets the start sumsets of task_input to the node of the task: A_0 and B_0 with the elements of the path added,
+// with last set to the last element added to each, as the search would have reached it.
+static void task_input_build(InputData* task_input, const ShardJob* job, const ShardTask* task)
+{
+    int a_elements[MAX_D * MAX_D + 1], b_elements[MAX_D * MAX_D + 1];
+    int a_count = 0, b_count = 0;
+    for (int x = 0; x <= MAX_D; ++x) {
+        for (int k = 0; k < job->a_in[x]; ++k)
+            a_elements[a_count++] = x;
+        for (int k = 0; k < job->b_in[x]; ++k)
+            b_elements[b_count++] = x;
+    }
+    if (task->a_length + task->b_length > SHARD_MAX_PATH)
+        fatal("Task %u has a path longer than %d", task->id, SHARD_MAX_PATH);
+    for (int k = 0; k < task->a_length; ++k)
+        a_elements[a_count++] = task->path[k];
+    for (int k = 0; k < task->b_length; ++k)
+        b_elements[b_count++] = task->path[task->a_length + k];
+    a_elements[a_count] = 0;
+    b_elements[b_count] = 0;
+
+    // input_data_init() doesn't clear the count of MAX_D
+    memset(task_input, 0, sizeof(*task_input));
+    input_data_init(task_input, 1, job->d, a_elements, b_elements);
+    if (task->a_length > 0)
+        task_input->a_start.last = task->path[task->a_length - 1];
+    if (task->b_length > 0)
+        task_input->b_start.last = task->path[task->a_length + task->b_length - 1];
+}
+
+void shard_work(const char* socket_path)
+{
+    int fd = socket_connect(socket_path);
+    ShardJob job;
+    // The coordinator finished before accepting us
+    if (!socket_receive(fd, &job, sizeof(job))) {
+        ASSERT_SYS_OK(close(fd));
+        return;
+    }
+    if (job.d < 3 || job.d > MAX_D)
+        fatal("Bad job from the coordinator: d = %d", job.d);
+
+    ShardTask task;
+    InputData task_input;
+    while (socket_receive(fd, &task, sizeof(task))) {
+        task_input_build(&task_input, &job, &task);
+        Solution solution = { 0 };
+        solution_init(&solution);
+        solve_nonrecursive_for(&task_input)(&task_input, job.bound, job.ceiling, NULL, NULL, &solution);
+
+        ShardResult result = { .id = task.id, .sum = solution.sum };
+        for (int x = 0; x <= MAX_D; ++x) {
+            result.a[x] = solution.a.count[x];
+            result.b[x] = solution.b.count[x];
+        }
+        // The coordinator stops early once it has a solution reaching the ceiling
+        if (!socket_send(fd, &result, sizeof(result)))
+            break;
+    }
+    ASSERT_SYS_OK(close(fd));
+}